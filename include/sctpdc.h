@@ -24,7 +24,10 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <QByteArray>
+#include <QList>
 #include <QObject>
+#include <QString>
 
 #include <memory>
 #include <tuple>
@@ -36,16 +39,38 @@ class DatagramChannel;
 class Connection : public QObject {
     Q_OBJECT
 public:
+    // stream ids are split by the DTLS role to not collide: the client takes even ones and the server odd ones
+    enum class DtlsRole { Client, Server };
+
     Connection(QObject *parent);
+    ~Connection() override;
+
+    void     setDtlsRole(DtlsRole role);
+    DtlsRole dtlsRole() const;
 
     void associate();
 
-    StreamChannel *  makeStreamChannel();
-    DatagramChannel *makeDatagramChannel();
+    // sctp packets to/from the DTLS transport. a batch of packets, e.g. from recvmmsg(), makes one readyRead() per
+    // channel
+    QByteArray readOutgoing();
+    void       writeIncoming(const QByteArray &data);
+    void       writeIncoming(const QList<QByteArray> &packets);
+
+    // Opens a channel with DATA_CHANNEL_OPEN (RFC 8832). Data may be written right away, it goes ordered after the
+    // OPEN until the peer acks it. With negotiatedStreamId (RTCDataChannelInit negotiated: true, id) no OPEN is sent
+    // and the peer has to make the same channel on its side. Returns nullptr if not associated yet or the stream is
+    // taken. Stream channels are ordered and datagram channels unordered, both reliable. Deleting a channel closes
+    // it by resetting its stream (RFC 8831 6.7). The stream id is free again once the peer has reset its side too.
+    StreamChannel *  makeStreamChannel(const QString &label = QString(), int negotiatedStreamId = -1);
+    DatagramChannel *makeDatagramChannel(const QString &label = QString(), int negotiatedStreamId = -1);
 
 signals:
     void connected();
     void disconnected();
+    void readyReadOutgoing();
+    // channels opened by the peer. ordered ones are streams, unordered ones are datagrams
+    void newStreamChannel(SctpDc::StreamChannel *channel);
+    void newDatagramChannel(SctpDc::DatagramChannel *channel);
 
 private:
     class Private;
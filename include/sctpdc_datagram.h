@@ -24,17 +24,64 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
+#include <QByteArray>
+#include <QList>
 #include <QObject>
 
+#include <memory>
+
 namespace SctpDc {
+namespace Sctp {
+    class Association;
+}
+class DataChannel;
+
+// Unordered reliable channel of whole messages. readyRead() comes once per batch of incoming packets, however many
+// messages it brings, so drain them all with readMessages().
 class DatagramChannel : public QObject {
     Q_OBJECT
 public:
-    DatagramChannel(QObject *parent);
+    // the payload protocol identifiers of WebRTC (RFC 8831 8). empty messages are sent as a single zero byte with the
+    // Empty variants and read back as empty data
+    enum PayloadType : quint32 { String = 51, Binary = 53, StringEmpty = 56, BinaryEmpty = 57 };
+
+    struct Message {
+        QByteArray  data; // shared with the association's reassembly. null if there was nothing to read
+        PayloadType type = Binary;
+
+        bool isString() const { return type == String || type == StringEmpty; }
+    };
+
+    ~DatagramChannel() override;
+
+    quint16 streamId() const;
+    QString label() const;
+
+    // Number of bytes written but not yet sent to the network. Same as RTCDataChannel.bufferedAmount
+    quint64 bufferedAmount() const;
+    void    setBufferedAmountLowThreshold(quint64 bytes);
+    quint64 bufferedAmountLowThreshold() const;
+
+    bool           hasPendingMessages() const;
+    Message        readMessage();
+    QList<Message> readMessages(int max = -1); // all if negative
+
+    // false if the association refused the message: it's closed or over its memory budget
+    bool sendMessage(const QByteArray &data, PayloadType type = Binary);
 
 signals:
 
     void errorOccured();
     void readyRead();
+    void bufferedAmountLow();
+
+private:
+    friend class Connection;
+    DatagramChannel(Sctp::Association *association, quint16 streamId, const QString &label, bool negotiated,
+                    QObject *parent);
+    DataChannel *dataChannel() const;
+
+    class Private;
+    std::unique_ptr<Private> d;
 };
 }
@@ -26,10 +26,61 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <QIODevice>
 
+#include <memory>
+
 namespace SctpDc {
+namespace Sctp {
+    class Association;
+}
+class DataChannel;
+
+// Ordered reliable channel as a byte stream. The device is unbuffered on the QIODevice level: received payloads are
+// kept as they came from the association and read(), peek() and readAll() return them as is, without a copy, as long
+// as the request matches a whole payload. Writes are cut into messages and refused (0 is returned) while the
+// channel's send queue or the association's send buffers are full. Wait for bufferedAmountLow() then.
 class StreamChannel : public QIODevice {
+    Q_OBJECT
+public:
+    // messages the written data is cut to. a message is reassembled whole by the peer before delivery
+    constexpr static int MaxMessageSize = 64 * 1024;
+    // writes stop once bufferedAmount() reaches it, or a message over the low threshold if that's more, so a large
+    // write comes back short instead of queueing all of it
+    constexpr static int SendBufferSize = 4 * MaxMessageSize;
+
+    ~StreamChannel() override;
+
+    quint16 streamId() const;
+    QString label() const;
+
+    // Number of bytes written but not yet sent to the network. Same as RTCDataChannel.bufferedAmount
+    quint64 bufferedAmount() const;
+    void    setBufferedAmountLowThreshold(quint64 bytes);
+    quint64 bufferedAmountLowThreshold() const;
+
+    bool   isSequential() const override;
+    qint64 bytesAvailable() const override;
+    qint64 bytesToWrite() const override;
+
+    using QIODevice::peek;
+    using QIODevice::read;
+    QByteArray read(qint64 maxSize);
+    QByteArray peek(qint64 maxSize);
+    QByteArray readAll();
+
+signals:
+    void bufferedAmountLow();
+
 protected:
-    qint64 writeData(const char *data, qint64 maxSize);
-    qint64 readData(char *data, qint64 maxSize);
+    qint64 writeData(const char *data, qint64 maxSize) override;
+    qint64 readData(char *data, qint64 maxSize) override;
+
+private:
+    friend class Connection;
+    StreamChannel(Sctp::Association *association, quint16 streamId, const QString &label, bool negotiated,
+                  QObject *parent);
+    DataChannel *dataChannel() const;
+
+    class Private;
+    std::unique_ptr<Private> d;
 };
 }
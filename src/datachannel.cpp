@@ -0,0 +1,99 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+
+#include "datachannel.h"
+
+#include <QtEndian>
+
+#include <algorithm>
+
+namespace SctpDc {
+
+namespace Dcep {
+    QByteArray ppid(quint32 value)
+    {
+        QByteArray proto(4, 0);
+        qToBigEndian(value, proto.data());
+        return proto;
+    }
+
+    quint32 ppid(const QByteArray &payloadProto)
+    {
+        return payloadProto.size() == 4 ? qFromBigEndian<quint32>(payloadProto.constData()) : 0;
+    }
+
+    QByteArray OpenMessage::serialize() const
+    {
+        QByteArray data(HeaderSize + label.size() + protocol.size(), 0);
+        data[0] = char(Open);
+        data[1] = char(channelType);
+        qToBigEndian(priority, data.data() + 2);
+        qToBigEndian(reliability, data.data() + 4);
+        qToBigEndian(quint16(label.size()), data.data() + 8);
+        qToBigEndian(quint16(protocol.size()), data.data() + 10);
+        std::copy(label.begin(), label.end(), data.begin() + HeaderSize);
+        std::copy(protocol.begin(), protocol.end(), data.begin() + HeaderSize + label.size());
+        return data;
+    }
+
+    bool OpenMessage::parse(const QByteArray &data)
+    {
+        if (data.size() < HeaderSize || quint8(data[0]) != Open) {
+            return false;
+        }
+        auto labelSize    = qFromBigEndian<quint16>(data.constData() + 8);
+        auto protocolSize = qFromBigEndian<quint16>(data.constData() + 10);
+        if (data.size() < HeaderSize + labelSize + protocolSize) {
+            return false;
+        }
+        channelType = quint8(data[1]);
+        priority    = qFromBigEndian<quint16>(data.constData() + 2);
+        reliability = qFromBigEndian<quint32>(data.constData() + 4);
+        label       = data.mid(HeaderSize, labelSize);
+        protocol    = data.mid(HeaderSize + labelSize, protocolSize);
+        return true;
+    }
+}
+
+DataChannel::DataChannel(Sctp::Association *association, quint16 streamId, quint8 channelType, const QString &label,
+                         bool negotiated) :
+    association(association), label(label), streamId(streamId), channelType(channelType), acked(negotiated)
+{
+}
+
+bool DataChannel::send(quint32 ppid, const QByteArray &data)
+{
+    return association->write(streamId, acked && isUnordered(), Dcep::ppid(ppid), data);
+}
+
+bool DataChannel::sendOpen()
+{
+    Dcep::OpenMessage open;
+    open.channelType = channelType;
+    open.label       = label.toUtf8();
+    return association->write(streamId, false, Dcep::ppid(Dcep::ControlPpid), open.serialize());
+}
+
+}
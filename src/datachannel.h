@@ -23,3 +23,70 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #endif
 
 #pragma once
+
+#include "sctp_association.h"
+
+#include <QString>
+
+namespace SctpDc {
+
+// Data Channel Establishment Protocol (RFC 8832) and WebRTC payload protocol identifiers (RFC 8831 8)
+namespace Dcep {
+    constexpr quint32 ControlPpid     = 50;
+    constexpr quint32 StringPpid      = 51;
+    constexpr quint32 BinaryPpid      = 53;
+    constexpr quint32 StringEmptyPpid = 56;
+    constexpr quint32 BinaryEmptyPpid = 57;
+
+    enum MessageType : quint8 { Ack = 0x02, Open = 0x03 };
+
+    // channel types. partial reliability isn't implemented (no FORWARD-TSN), so such channels are reliable
+    constexpr quint8 ReliableChannel = 0x00;
+    constexpr quint8 UnorderedFlag   = 0x80;
+
+    QByteArray ppid(quint32 value);
+    quint32    ppid(const QByteArray &payloadProto);
+
+    // DATA_CHANNEL_OPEN (RFC 8832 5.1)
+    struct OpenMessage {
+        constexpr static int HeaderSize = 12;
+
+        quint8     channelType = ReliableChannel;
+        quint16    priority    = 0;
+        quint32    reliability = 0;
+        QByteArray label;
+        QByteArray protocol;
+
+        QByteArray serialize() const;
+        bool       parse(const QByteArray &data); // false if malformed
+    };
+}
+
+// Common part of StreamChannel and DatagramChannel privates. Connection routes the messages of the channel's stream
+// here and the channel sends through it.
+class DataChannel {
+public:
+    DataChannel(Sctp::Association *association, quint16 streamId, quint8 channelType, const QString &label,
+                bool negotiated);
+    virtual ~DataChannel() = default;
+
+    // unordered channels start sending unordered only after the OPEN is acked, so nothing overtakes the OPEN. data sent
+    // ordered right after the OPEN is fine (RFC 8832 6), so no round trip is spent before the data flows.
+    bool send(quint32 ppid, const QByteArray &data);
+    bool sendOpen();
+    bool isUnordered() const { return channelType & Dcep::UnorderedFlag; }
+
+    // messages are queued one by one and then readyRead is emitted once for the whole incoming batch. they stay
+    // accounted by the association (receive window, memory budget) until consumed as the application reads them
+    virtual void incomingMessage(Sctp::AssociationCore::Message &&message) = 0;
+    virtual void notifyIncoming()                                          = 0;
+
+    Sctp::Association *association;
+    QObject *          object = nullptr; // the public channel
+    QString            label;
+    quint16            streamId;
+    quint8             channelType;
+    bool               acked; // the OPEN is acked, explicitly or by the data from the peer. always true if negotiated
+};
+
+}
@@ -24,109 +24,49 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #pragma once
 
-#include "sctp_common.h"
+#include "sctp_association_core.h"
 
-#include <QByteArray>
-#include <QElapsedTimer>
 #include <QObject>
-#include <QtEndian>
 
-#include <deque>
+class QTimer;
 
 namespace SctpDc { namespace Sctp {
 
-    class InitChunk;
-    class InitAckChunk;
-    class CookieEchoChunk;
-    class CookieAckChunk;
-    class SackChunk;
-    class DataChunk;
-
-    class Association : public QObject {
+    // AssociationCore as a QObject. Events are emitted as signals and timeouts are served with a QTimer, or by the
+    // endpoint owning the association.
+    class Association : public QObject, public AssociationCore, private AssociationSink {
         Q_OBJECT
     public:
-        enum class State {
-            Closed,
-            CookieWait,
-            CookieEchoed,
-            Established,
-            ShutdownPending,
-            ShutdownSent,
-            ShutdownReceived,
-            ShutdownAckSent
-        };
-
-        enum class Error { None, WrongState, ProtocolViolation, VerificationTag, InvalidCookie, Unknown };
-
         Association(quint16 sourcePort, quint16 destinationPort, QObject *parent = nullptr);
-
-        void  associate();
-        void  abort(Error error);
-        State state() const { return state_; }
-
-        // read payload extracted from sctp
-        QByteArray readOutgoing();
-
-        // data - an sctp packet right from network. note only sctp and its payload, nothing else
-        void writeIncoming(const QByteArray &data);
-
-        void write(quint16 streamId, bool unordered, const QByteArray &payloadProto, const QByteArray &data);
+        ~Association() override;
 
     signals:
         void readyReadOutgoing();
+        void readyReadIncoming();
         void errorOccured();
         void established();
+        void bufferedAmountLow();
+        void streamBufferedAmountLow(quint16 streamId);
+        void incomingStreamsReset(const QList<quint16> &streamIds);
+        void outgoingStreamsReset(const QList<quint16> &streamIds);
 
     private:
-        void       populateHeader(Packet &packet);
-        void       sendFirstPriority(Packet &packet);
-        void       trySend();
-        QByteArray makeStateCookie();
-        void       setError(Error error);
-        void       initRemote(const InitChunk &chunk);
-
-        void incomingChunk(const InitChunk &chunk);
-        void incomingChunk(const InitAckChunk &chunk);
-        void incomingChunk(const CookieEchoChunk &chunk);
-        void incomingChunk(const CookieAckChunk &chunk);
-        void incomingChunk(const SackChunk &);
-        void incomingChunk(const DataChunk &);
-
-    private:
-        struct UnackChunk {
-            quint32    timestamp; // monotonic time
-            quint32    tsn;
-            QByteArray data;
-        };
-
-        State                         state_   = State::Closed;
-        quint8                        ackState = 0;
-        QByteArray                    privKey; // for cookie HMAC
-        QElapsedTimer                 timer_;
-        std::deque<Packet>            incomingPackets_;
-        std::deque<Packet>            outgoingPackets_;
-        std::deque<UnackChunk>        dataSendQueue_;
-        std::deque<UnackChunk>        controlSendQueue_;
-        std::map<quint32, UnackChunk> unacknowledgedChunks;   // outgoing chunks timestamp => chunk
-        std::map<quint16, quint16>    stream2ssn_;            // stream id to stream seqnum
-        quint32                       myVerificationTag_ = 0; // in incoming packets. local-generated.
-        quint32 peerVerificationTag_  = 0; // with each outgoing sctp packet. to be checked on remote side
-        quint32 nextTsn_              = 0;
-        quint32 lastRcvdTsn_          = 0;
-        quint16 sourcePort_           = 0;
-        quint16 destinationPort_      = 0;
-        quint16 inboundStreamsCount_  = 65535;
-        quint16 outboundStreamsCount_ = 65535;
-        quint32 localWindowCredit_    = 512 * 1024;
-        quint32 localUsedCredit_      = 0; // total bytes we not yet acknowledged
-        quint32 remoteWindowCredit_   = 512 * 1024;
-        quint32 remoteUsedCredit_     = 0;    // total sent but not yet aknowledged bytes
-        quint32 mtu_                  = 1400; // for loopback may be way more
-        quint32 cwnd_;                        // Congestion control window
-        quint32 ssthresh_;                    // Slow-start threshold
-        quint32 partialBytesAcked;            // TODO not used?
-        Error   error_ = Error::None;
+        friend class Endpoint;
+
+        void onReadyReadOutgoing() override;
+        void onReadyReadIncoming() override { emit readyReadIncoming(); }
+        void onErrorOccured() override { emit errorOccured(); }
+        void onEstablished() override { emit established(); }
+        void onBufferedAmountLow() override { emit bufferedAmountLow(); }
+        void onStreamBufferedAmountLow(quint16 streamId) override { emit streamBufferedAmountLow(streamId); }
+        void onIncomingStreamsReset(const QList<quint16> &streamIds) override { emit incomingStreamsReset(streamIds); }
+        void onOutgoingStreamsReset(const QList<quint16> &streamIds) override { emit outgoingStreamsReset(streamIds); }
+        void scheduleTimeout(qint64 usecs) override;
+
+        QTimer *  timeoutTimer_     = nullptr; // created on first use
+        Endpoint *endpoint_         = nullptr; // drives the timeouts instead of timeoutTimer_ if set
+        qint64    endpointDeadline_ = -1;      // scheduled with the endpoint, by the endpoint's clock
+        bool      endpointReady_    = false;   // in the endpoint's list of associations with output
     };
 
-} // namespace Sctp
-} // namespace SctpDc
+}}
@@ -0,0 +1,1994 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_association_core.h"
+#include "sctp_chunk.h"
+#include "sctp_cookie.h"
+#include "sctp_parameter.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#endif
+
+#include <atomic>
+
+namespace SctpDc { namespace Sctp {
+    namespace {
+        // RFC 8899 Packetization Layer Path MTU Discovery
+        constexpr quint32 BasePathMtu         = 1200;
+        constexpr int     MaxPathMtuProbes    = 3;
+        constexpr quint32 PathMtuSearchStep   = 32;        // the search stops when the range is narrower
+        constexpr qint64  PathMtuProbeTimeout = 1000000;   // microseconds
+        constexpr qint64  PathMtuRaiseTimeout = 600000000; // microseconds
+
+        constexpr qint64 DelayedAckTimeout     = 200000; // microseconds
+        constexpr quint8 DelayedAckPackets     = 2;      // sack at least every second packet with data
+        constexpr int    MaxReportedDuplicates = 16;
+        constexpr qint64 DefaultRtt            = 100000; // microseconds. until measured
+        constexpr qint64 MinAutotuneInterval   = 10000;  // microseconds. shorter rtts are below scheduling noise
+
+        // the peer accounts only user data in its receive window
+        inline quint32 userDataSize(const QByteArray &chunk)
+        {
+            return qFromBigEndian<quint16>(chunk.constData() + 2) - DataChunk::MinHeaderSize;
+        }
+
+        std::atomic<quint64> receiveWindowUsage { 0 };
+        std::atomic<quint64> receiveWindowLimit { quint64(1024) * 1024 * 1024 };
+
+        inline QList<SackChunk::Gap> nrGaps(const SackChunk &) { return {}; }
+        inline QList<SackChunk::Gap> nrGaps(const NrSackChunk &chunk) { return chunk.nrGaps(); }
+
+        std::atomic<quint64> bufferedMemoryUsage { 0 };
+        std::atomic<quint64> bufferedMemoryLimitBytes { quint64(1024) * 1024 * 1024 };
+        std::atomic<quint32> associationsCount { 0 };
+
+        // associations are held to their fair share of the budget above this usage
+        inline bool underMemoryPressure(quint64 usage, quint64 limit) { return usage >= limit - limit / 8; }
+
+        inline quint64 fairMemoryShare(quint64 limit) { return limit / std::max(associationsCount.load(), 1u); }
+
+        // RFC 6525 requests other than outgoing ssn reset. we don't do them, but they consume sequence numbers
+        inline bool isUnsupportedReconfigRequest(quint16 type)
+        {
+            return type == 14 || type == 15 || type == 17 || type == 18;
+        }
+
+        QList<quint16> toList(const std::vector<quint16> &streams)
+        {
+            QList<quint16> list;
+            list.reserve(int(streams.size()));
+            for (auto streamId : streams) {
+                list.append(streamId);
+            }
+            return list;
+        }
+
+        quint64 random64()
+        {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+            return QRandomGenerator::global()->generate64();
+#else
+            return (quint64(quint32(qrand())) << 32) | quint32(qrand());
+#endif
+        }
+    }
+
+    void AssociationCore::populateHeader(Packet &packet)
+    {
+        packet.setVerificationTag(peerVerificationTag_);
+        packet.setSourcePort(sourcePort_);
+        packet.setDestinationPort(destinationPort_);
+        packet.setChecksum();
+    }
+
+    void AssociationCore::sendFirstPriority(Packet &packet)
+    {
+        populateHeader(packet);
+        outgoingPackets_.push_front(std::move(packet));
+        notifyOutgoing();
+    }
+
+    void AssociationCore::notifyOutgoing()
+    {
+        if (burstDepth_) {
+            outgoingNotify_ = true;
+            return;
+        }
+        sink_->onReadyReadOutgoing();
+    }
+
+    AssociationCore::OutgoingBurst::~OutgoingBurst()
+    {
+        if (--core_->burstDepth_ == 0 && core_->outgoingNotify_) {
+            core_->outgoingNotify_ = false;
+            core_->sink_->onReadyReadOutgoing();
+        }
+    }
+
+    void AssociationCore::trySend()
+    {
+        if (ingesting_) {
+            sendDeferred_ = true;
+            return;
+        }
+        if (!(state_ == State::Established || state_ == State::CookieEchoed))
+            return;
+
+        OutgoingBurst burst(this);
+
+        // RFC 4960 6.1. rule B: no new data while cwnd or more bytes are in flight. rule A: no data beyond
+        // the peer's window, but one chunk may always be in flight to probe a closed window.
+        auto limit = [this](const UnackChunk &chunk) {
+            if (remoteUsedCredit_ >= cwnd_)
+                return Stall::Congestion;
+            if (remoteUsedCredit_ && remoteUsedCredit_ + userDataSize(chunk.data) > remoteWindowCredit_)
+                return Stall::Window;
+            return Stall::None;
+        };
+        auto                 ts             = now();
+        const bool           pacing         = shaper_ && shaper_->pacingGain > 0;
+        const auto           holdBefore     = holdDeadline_;
+        auto                 stall          = Stall::None;
+        qint64               rateWait       = -1; // until the rate limits let more data out
+        bool                 started        = false;
+        auto                 bufferedBefore = bufferedAmount_;
+        std::vector<quint16> lowStreams; // crossed their threshold
+        auto sent    = [this, ts, &started](UnackChunk &chunk) {
+            chunk.probe = remoteUsedCredit_ + userDataSize(chunk.data) > remoteWindowCredit_;
+            if (chunk.probe)
+                stats_.zeroWindowProbes++;
+            if (!rttMeasuring_ && !chunk.transmitted) {
+                rttMeasuring_ = true;
+                rttTsn_       = chunk.tsn;
+            }
+            chunk.timestamp   = ts;
+            chunk.transmitted = true;
+            remoteUsedCredit_ += userDataSize(chunk.data);
+            if (t3Deadline_ < 0) {
+                t3Deadline_ = ts + rto_;
+                started     = true;
+            }
+        };
+
+        if (pacing) {
+            refillPacingCredit(ts);
+        }
+        for (;;) {
+            Packet pkt;
+            // a chunk fits if the packet is still empty (rely on ip fragmentation) or it won't overflow mtu
+            auto fits = [&pkt, this](const QByteArray &chunk) {
+                return pkt.size() <= Packet::HeaderSize || pkt.size() + chunk.size() <= int(mtu_);
+            };
+            while (controlSendQueue_.size() && fits(controlSendQueue_.front().data)) {
+                auto const &chunk = controlSendQueue_.front();
+                pkt.appendRawChunk(chunk.data);
+                controlSendQueue_.pop_front();
+            }
+            const int  controlSize = pkt.size();
+            const bool paced       = pacing && shaper_->pacingCredit < qint64(mtu_); // control chunks are never held
+
+            // retransmissions go first
+            for (auto it = unacknowledgedChunks.begin(); !paced && retransmitCount_ && it != unacknowledgedChunks.end();
+                 ++it) {
+                auto &chunk = it->second;
+                if (!chunk.retransmit)
+                    continue;
+                if (!fits(chunk.data) || (stall = limit(chunk)) != Stall::None)
+                    break;
+                chunk.retransmit = false;
+                retransmitCount_--;
+                if (rttMeasuring_ && rttTsn_ == chunk.tsn)
+                    rttMeasuring_ = false; // Karn's algorithm
+                sent(chunk);
+                pkt.appendRawChunk(chunk.data);
+            }
+
+            size_t next = 0;
+            while (!paced && !retransmitCount_ && (next = nextDataChunk(ts, rateWait)) < dataSendQueue_.size()
+                   && fits(dataSendQueue_[next].data) && (stall = limit(dataSendQueue_[next])) == Stall::None) {
+                auto chunk = std::move(dataSendQueue_[next]);
+                dataSendQueue_.erase(next);
+                dataQueuedBytes_ -= chunk.data.size();
+
+                // tsns are assigned in the order of sending, so held messages don't leave gaps
+                DataChunk  data { chunk.data, 0, chunk.data.size() };
+                const auto streamId = data.streamIdentifier();
+                const auto size     = userDataSize(chunk.data);
+                chunk.tsn           = nextTsn_++;
+                data.setTsn(chunk.tsn);
+                sendingStream_ = data.isEnding() ? -1 : streamId;
+                if (shaper_) {
+                    if (shaper_->rateLimit.rate) {
+                        shaper_->rateLimit.tokens -= size;
+                    }
+                    if (auto bucket = shaper_->streamRateLimits.find(streamId)) {
+                        bucket->tokens -= size;
+                    }
+                }
+
+                auto &stream = outboundStreams_[streamId];
+                if (stream.bufferedAmount > stream.lowThreshold && stream.bufferedAmount - size <= stream.lowThreshold) {
+                    lowStreams.push_back(streamId);
+                }
+                stream.bufferedAmount -= size;
+                bufferedAmount_ -= size;
+                sent(chunk);
+                pkt.appendRawChunk(chunk.data);
+                unacknowledgedChunks.emplace(chunk.tsn, std::move(chunk));
+            }
+            if (pkt.size() <= Packet::HeaderSize)
+                break; // nothing to send
+            if (pacing) {
+                shaper_->pacingCredit -= pkt.size() - controlSize;
+            }
+            populateHeader(pkt);
+            outgoingPackets_.push_back(std::move(pkt));
+            notifyOutgoing();
+        }
+        if (dataSendQueue_.empty()) {
+            flushDeadline_ = -1;
+        }
+        setStall(dataSendQueue_.empty() && !retransmitCount_ ? Stall::None : stall);
+        holdDeadline_ = -1;
+        if (stall == Stall::None && (!dataSendQueue_.empty() || retransmitCount_)) {
+            // held by pacing until there is credit for a full packet and by the rate limits until they have tokens
+            if (pacing && shaper_->pacingCredit < qint64(mtu_)) {
+                holdDeadline_ = ts + qint64(double(qint64(mtu_) - shaper_->pacingCredit) / pacingRate()) + 1;
+            }
+            if (rateWait > 0) {
+                holdDeadline_ = std::max(holdDeadline_, ts + rateWait);
+            }
+        }
+        if (started || holdDeadline_ != holdBefore) {
+            updateTimer();
+        }
+        if (streamReset_ && !streamReset_->pending.empty() && streamReset_->request.isEmpty()) {
+            sendStreamReset(); // the data of the streams may be all sent now
+        }
+
+        // last as the application may write more right from the slots
+        for (auto streamId : lowStreams) {
+            sink_->onStreamBufferedAmountLow(streamId);
+        }
+        if (bufferedBefore > bufferedLowThreshold_ && bufferedAmount_ <= bufferedLowThreshold_) {
+            sink_->onBufferedAmountLow();
+        }
+    }
+
+    size_t AssociationCore::nextDataChunk(qint64 ts, qint64 &wait)
+    {
+        // without rate limits it's always the head of the queue
+        wait = -1;
+        if (dataSendQueue_.empty() || !shaper_ || (!shaper_->rateLimit.rate && shaper_->streamRateLimits.empty())) {
+            return 0;
+        }
+        // fragments of a message need consecutive tsns, so a started message goes on regardless of the limits
+        if (sendingStream_ >= 0) {
+            for (size_t i = 0; i < dataSendQueue_.size(); i++) {
+                if (qFromBigEndian<quint16>(dataSendQueue_[i].data.constData() + 8) == sendingStream_) {
+                    return i;
+                }
+            }
+            sendingStream_ = -1;
+        }
+        auto &rateLimit = shaper_->rateLimit;
+        if (rateLimit.rate) {
+            rateLimit.refill(ts);
+            if (rateLimit.tokens <= 0) {
+                wait = rateLimit.wait();
+                return dataSendQueue_.size();
+            }
+        }
+        // the first message of a stream with tokens. later messages of a held stream are held too to keep the order
+        std::vector<quint16> held;
+        qint64               earliest = -1;
+        for (size_t i = 0; i < dataSendQueue_.size(); i++) {
+            const auto streamId = qFromBigEndian<quint16>(dataSendQueue_[i].data.constData() + 8);
+            if (std::find(held.begin(), held.end(), streamId) != held.end()) {
+                continue;
+            }
+            auto bucket = shaper_->streamRateLimits.find(streamId);
+            if (!bucket) {
+                return i;
+            }
+            bucket->refill(ts);
+            if (bucket->tokens > 0) {
+                return i;
+            }
+            earliest = earliest < 0 ? bucket->wait() : std::min(earliest, bucket->wait());
+            held.push_back(streamId);
+        }
+        wait = earliest;
+        return dataSendQueue_.size();
+    }
+
+    void AssociationCore::setRateLimit(quint64 bytesPerSecond, quint64 burst)
+    {
+        auto &     bucket = shaper().rateLimit;
+        const bool added  = !bucket.rate;
+        bucket.rate       = bytesPerSecond;
+        bucket.burst      = qint64(std::max(burst, quint64(mtu_))); // a smaller bucket never fills;
+        bucket.tokens     = added ? bucket.burst : std::min(bucket.tokens, bucket.burst);
+        bucket.updated    = now();
+        trySend(); // what's held may go now
+    }
+
+    void AssociationCore::setRateLimit(quint16 streamId, quint64 bytesPerSecond, quint64 burst)
+    {
+        if (!bytesPerSecond) {
+            shaper().streamRateLimits.erase(streamId);
+        } else {
+            auto &bucket   = shaper().streamRateLimits[streamId];
+            bool  added    = !bucket.rate;
+            bucket.rate    = bytesPerSecond;
+            bucket.burst   = qint64(std::max(burst, quint64(mtu_))); // a smaller bucket never fills;
+            bucket.tokens  = added ? bucket.burst : std::min(bucket.tokens, bucket.burst);
+            bucket.updated = now();
+        }
+        trySend();
+    }
+
+    quint64 AssociationCore::rateLimit(quint16 streamId) const
+    {
+        auto bucket = shaper_ ? shaper_->streamRateLimits.find(streamId) : nullptr;
+        return bucket ? bucket->rate : 0;
+    }
+
+    double AssociationCore::pacingRate() const
+    {
+        const double gain = shaper_->pacingGain * (cwnd_ < ssthresh_ ? 2 : 1) / 100.0;
+        return std::max(gain * cwnd_ / double(srtt_ ? srtt_ : DefaultRtt), 1e-6);
+    }
+
+    void AssociationCore::refillPacingCredit(qint64 ts)
+    {
+        // idle time beyond a round trip doesn't matter, the credit is capped by the burst size anyway
+        auto &     shaper    = *shaper_;
+        const auto elapsed   = std::min(ts - shaper.pacingUpdated, srtt_ ? srtt_ : DefaultRtt);
+        const auto credit    = shaper.pacingCredit + qint64(elapsed * pacingRate());
+        shaper.pacingUpdated = ts;
+        shaper.pacingCredit  = std::min(credit, qint64(shaper.maxBurst) * mtu_);
+    }
+
+    quint64 AssociationCore::bufferedAmount(quint16 streamId) const
+    {
+        auto stream = outboundStreams_.find(streamId);
+        return stream ? stream->bufferedAmount : 0;
+    }
+
+    void AssociationCore::setBufferedAmountLowThreshold(quint16 streamId, quint64 bytes)
+    {
+        outboundStreams_[streamId].lowThreshold = bytes;
+    }
+
+    quint64 AssociationCore::bufferedAmountLowThreshold(quint16 streamId) const
+    {
+        auto stream = outboundStreams_.find(streamId);
+        return stream ? stream->lowThreshold : 0;
+    }
+
+    void AssociationCore::setStreamReceiveLimit(quint16 streamId, quint32 bytes)
+    {
+        inboundStreams_[streamId].receiveLimit = bytes;
+    }
+
+    quint32 AssociationCore::streamReceiveLimit(quint16 streamId) const
+    {
+        auto stream = inboundStreams_.find(streamId);
+        return stream && stream->receiveLimit ? stream->receiveLimit : streamReceiveLimit_;
+    }
+
+    void AssociationCore::setStreamSendLimit(quint16 streamId, quint32 bytes)
+    {
+        outboundStreams_[streamId].sendLimit = bytes;
+    }
+
+    quint32 AssociationCore::streamSendLimit(quint16 streamId) const
+    {
+        auto stream = outboundStreams_.find(streamId);
+        return stream && stream->sendLimit ? stream->sendLimit : streamSendLimit_;
+    }
+
+    quint64 AssociationCore::receivedAmount(quint16 streamId) const
+    {
+        auto stream = inboundStreams_.find(streamId);
+        return stream ? stream->receivedAmount : 0;
+    }
+
+    bool AssociationCore::resetStreams(const QList<quint16> &streamIds)
+    {
+        if (state_ != State::Established || !peerReconfig_ || streamIds.isEmpty()) {
+            return false;
+        }
+        auto &reset = streamReset();
+        for (auto streamId : streamIds) {
+            if (!resettingStream(streamId)) {
+                reset.pending.push_back(streamId);
+            }
+        }
+        if (reset.request.isEmpty()) {
+            sendStreamReset();
+        }
+        return true;
+    }
+
+    bool AssociationCore::resettingStream(quint16 streamId) const
+    {
+        if (!streamReset_) {
+            return false;
+        }
+        const auto &reset = *streamReset_;
+        return std::find(reset.pending.begin(), reset.pending.end(), streamId) != reset.pending.end()
+            || std::find(reset.requested.begin(), reset.requested.end(), streamId) != reset.requested.end();
+    }
+
+    void AssociationCore::sendStreamReset()
+    {
+        auto &reset = *streamReset_;
+        if (reset.request.isEmpty()) {
+            // only streams with all their data sent, so the last assigned tsn covers it
+            auto ready = std::stable_partition(reset.pending.begin(), reset.pending.end(), [this](quint16 streamId) {
+                auto stream = outboundStreams_.find(streamId);
+                return !stream || !stream->bufferedAmount;
+            });
+            if (ready == reset.pending.begin()) {
+                return;
+            }
+            reset.requested.assign(reset.pending.begin(), ready);
+            reset.pending.erase(reset.pending.begin(), ready);
+
+            Packet packet;
+            auto   request = packet.appendChunk<ReconfigChunk>().appendParameter<OutgoingSsnResetRequestParameter>(
+                OutgoingSsnResetRequestParameter::MinHeaderSize - 4 + int(reset.requested.size()) * 2);
+            request.setRequestSequence(reconfigSeq_);
+            request.setResponseSequence(peerReconfigSeq_ - 1);
+            request.setLastAssignedTsn(nextTsn_ - 1);
+            request.setStreams(toList(reset.requested));
+            reset.request = packet.takeData().mid(Packet::HeaderSize);
+        }
+        controlSendQueue_.push_back({ 0, 0, reset.request });
+        reconfigDeadline_ = now() + rto_;
+        updateTimer();
+        trySend();
+    }
+
+    void AssociationCore::sendReconfigResponse(quint32 seq, quint32 result)
+    {
+        Packet packet;
+        auto   response = packet.appendChunk<ReconfigChunk>().appendParameter<ReconfigResponseParameter>(
+            ReconfigResponseParameter::MinHeaderSize - 4);
+        response.setResponseSequence(seq);
+        response.setResult(result);
+        controlSendQueue_.push_back({ 0, 0, packet.takeData().mid(Packet::HeaderSize) });
+        trySend();
+    }
+
+    void AssociationCore::resetInboundStreams(const QList<quint16> &streamIds)
+    {
+        auto streams = streamIds;
+        if (streams.isEmpty()) {
+            for (const auto &stream : inboundStreams_) {
+                streams.append(stream.first);
+            }
+        }
+        for (auto streamId : streams) {
+            auto stream = inboundStreams_.find(streamId);
+            if (!stream) {
+                continue;
+            }
+            // unread messages are still accounted to the stream. it's freed when they are read
+            stream->nextSsn = 0;
+            stream->reset   = true;
+            if (!stream->receivedAmount && !stream->receiveLimit && stream->pending.empty()) {
+                inboundStreams_.erase(streamId);
+            }
+        }
+    }
+
+    void AssociationCore::resetOutboundStreams(const QList<quint16> &streamIds)
+    {
+        for (auto streamId : streamIds) {
+            auto stream = outboundStreams_.find(streamId);
+            if (!stream) {
+                continue;
+            }
+            // configured thresholds and limits outlive the reset
+            if (stream->sendLimit || stream->lowThreshold) {
+                stream->nextSsn = 0;
+            } else {
+                outboundStreams_.erase(streamId);
+            }
+        }
+    }
+
+    void AssociationCore::setStall(Stall stall)
+    {
+        if (stall == stall_) {
+            return;
+        }
+        auto ts = now();
+        if (stall_ == Stall::Window) {
+            stats_.windowLimitedTime += ts - stallStarted_;
+        } else if (stall_ == Stall::Congestion) {
+            stats_.congestionLimitedTime += ts - stallStarted_;
+        }
+        stall_        = stall;
+        stallStarted_ = ts;
+    }
+
+    AssociationCore::Statistics AssociationCore::statistics() const
+    {
+        auto stats = stats_;
+        if (stall_ == Stall::Window) {
+            stats.windowLimitedTime += now() - stallStarted_;
+        } else if (stall_ == Stall::Congestion) {
+            stats.congestionLimitedTime += now() - stallStarted_;
+        }
+        return stats;
+    }
+
+    quint64 AssociationCore::memoryUsage() const
+    {
+        constexpr quint64 TreeNodeOverhead = 32; // std::map/std::set node header
+        auto              chunks           = [](const RingQueue<UnackChunk> &queue) {
+            quint64 usage = queue.capacity() * sizeof(UnackChunk);
+            for (size_t i = 0; i < queue.size(); i++) {
+                usage += quint64(queue[i].data.capacity());
+            }
+            return usage;
+        };
+
+        quint64 usage = sizeof(*this) + chunks(dataSendQueue_) + chunks(controlSendQueue_);
+        usage += outgoingPackets_.capacity() * sizeof(Packet);
+        for (size_t i = 0; i < outgoingPackets_.size(); i++) {
+            usage += quint64(outgoingPackets_[i].size());
+        }
+        for (const auto &chunk : unacknowledgedChunks) {
+            usage += sizeof(chunk) + TreeNodeOverhead + quint64(chunk.second.data.capacity());
+        }
+        for (const auto &fragment : fragments_) {
+            usage += sizeof(fragment) + TreeNodeOverhead + quint64(fragment.second.data.capacity());
+        }
+        usage += receivedTsns_.size() * (sizeof(quint32) + TreeNodeOverhead);
+        usage += duplicateTsns_.capacity() * sizeof(quint32);
+        usage += outboundStreams_.capacity() * sizeof(*outboundStreams_.begin());
+        usage += inboundStreams_.capacity() * sizeof(*inboundStreams_.begin());
+        for (const auto &stream : inboundStreams_) {
+            for (const auto &message : stream.second.pending) {
+                usage += sizeof(message) + TreeNodeOverhead + quint64(message.second.data.capacity());
+            }
+            usage += stream.second.held.capacity() * sizeof(Message);
+            for (size_t i = 0; i < stream.second.held.size(); i++) {
+                usage += quint64(stream.second.held[i].data.capacity());
+            }
+        }
+        usage += incomingMessages_.capacity() * sizeof(Message);
+        for (size_t i = 0; i < incomingMessages_.size(); i++) {
+            usage += quint64(incomingMessages_[i].data.capacity());
+        }
+        if (shaper_) {
+            usage += sizeof(Shaper) + shaper_->streamRateLimits.capacity() * sizeof(*shaper_->streamRateLimits.begin());
+        }
+        if (streamReset_) {
+            usage += sizeof(StreamReset) + quint64(streamReset_->request.capacity())
+                + (streamReset_->pending.capacity() + streamReset_->requested.capacity()
+                   + streamReset_->deferred.capacity())
+                    * sizeof(quint16);
+        }
+        return usage;
+    }
+
+    void AssociationCore::setIdleTrimDelay(qint64 usecs)
+    {
+        idleTrimDelay_ = std::max(usecs, qint64(0));
+        if (trimDeadline_ >= 0) {
+            trimDeadline_ = idleTrimDelay_ ? lastActive_ + idleTrimDelay_ : -1;
+            updateTimer();
+        }
+    }
+
+    void AssociationCore::markActive()
+    {
+        // timers check the timestamp lazily, so they are armed once per active period, not per packet. see
+        // processTimeouts() and heartbeatTimeout()
+        lastActive_ = now();
+        if (idleTrimDelay_ && trimDeadline_ < 0) {
+            trimDeadline_ = lastActive_ + idleTrimDelay_;
+            updateTimer();
+        }
+    }
+
+    void AssociationCore::trimMemory()
+    {
+        outgoingPackets_.shrink();
+        dataSendQueue_.shrink();
+        controlSendQueue_.shrink();
+        incomingMessages_.shrink();
+        for (size_t i = 0; i < incomingMessages_.size(); i++) {
+            incomingMessages_[i].data.squeeze();
+        }
+        outboundStreams_.shrink();
+        inboundStreams_.shrink();
+        for (auto &stream : inboundStreams_) {
+            stream.second.held.shrink();
+        }
+        duplicateTsns_.shrink_to_fit();
+    }
+
+    void AssociationCore::setRtoBounds(qint64 min, qint64 max)
+    {
+        rtoMin_ = min;
+        rtoMax_ = std::max(min, max);
+        rto_    = qBound(rtoMin_, rto_, rtoMax_);
+    }
+
+    void AssociationCore::updateRtt(qint64 rtt)
+    {
+        // RFC 4960 6.3.1
+        if (!srtt_) {
+            srtt_   = std::max(rtt, qint64(1));
+            rttvar_ = rtt / 2;
+        } else {
+            rttvar_ = (3 * rttvar_ + std::abs(srtt_ - rtt)) / 4;
+            srtt_   = std::max((7 * srtt_ + rtt) / 8, qint64(1));
+        }
+        rto_ = qBound(rtoMin_, srtt_ + 4 * rttvar_, rtoMax_);
+    }
+
+    void AssociationCore::retransmissionTimeout()
+    {
+        // RFC 4960 6.3.3 and 7.2.3. everything in flight is considered lost
+        stats_.retransmissionTimeouts++;
+        if (!countError()) {
+            return;
+        }
+        ssthresh_          = std::max(cwnd_ / 2, 4 * mtu_);
+        cwnd_              = mtu_;
+        partialBytesAcked  = 0;
+        rto_               = std::min(rto_ * 2, rtoMax_);
+        rttMeasuring_      = false;
+        for (auto &p : unacknowledgedChunks) {
+            auto &chunk = p.second;
+            if (chunk.gapAcked || chunk.retransmit)
+                continue;
+            chunk.retransmit = true;
+            retransmitCount_++;
+            remoteUsedCredit_ -= userDataSize(chunk.data);
+        }
+        trySend();
+    }
+
+    void AssociationCore::setHeartbeatInterval(qint64 usecs)
+    {
+        heartbeatInterval_ = std::max(usecs, qint64(0));
+        if (state_ == State::Established && !heartbeatNonce_) {
+            heartbeatDeadline_ = heartbeatInterval_ ? now() + heartbeatInterval_ : -1;
+            updateTimer();
+        }
+    }
+
+    void AssociationCore::heartbeatTimeout()
+    {
+        if (state_ != State::Established || !heartbeatInterval_) {
+            return;
+        }
+        const auto ts = now();
+        if (heartbeatNonce_) {
+            // RFC 4960 8.3. unanswered within rto
+            heartbeatNonce_ = 0;
+            rto_            = std::min(rto_ * 2, rtoMax_);
+            if (!countError()) {
+                return;
+            }
+        } else if (!unacknowledgedChunks.empty() || ts - lastActive_ < heartbeatInterval_) {
+            // not idle. data in flight is watched by the retransmission timer instead
+            heartbeatDeadline_ = (unacknowledgedChunks.empty() ? lastActive_ : ts) + heartbeatInterval_;
+            return;
+        }
+        heartbeatNonce_ = random64() | 1;
+
+        Packet packet;
+        auto   info = packet.appendChunk<HeartbeatChunk>().appendParameter<HeartbeatInfoParameter>(
+            HeartbeatInfoParameter::MinHeaderSize - 4);
+        info.setNonce(heartbeatNonce_);
+        info.setTimestamp(ts);
+        info.setProbeSize(0);
+        controlSendQueue_.push_back({ 0, 0, packet.takeData().mid(Packet::HeaderSize) });
+        heartbeatDeadline_ = ts + rto_;
+        trySend();
+    }
+
+    bool AssociationCore::countError()
+    {
+        if (++errorCount_ <= maxRetransmissions_) {
+            return true;
+        }
+        // RFC 4960 8.1. the peer is unreachable
+        state_ = State::Closed;
+        for (auto deadline : { &flushDeadline_, &pmtuDeadline_, &sackDeadline_, &t3Deadline_, &holdDeadline_,
+                               &reconfigDeadline_, &heartbeatDeadline_ }) {
+            *deadline = -1;
+        }
+        updateTimer();
+        setError(Error::PeerUnreachable);
+        return false;
+    }
+
+    void AssociationCore::updateTimer()
+    {
+        qint64 deadline = -1;
+        for (auto d : { flushDeadline_, pmtuDeadline_, sackDeadline_, t3Deadline_, holdDeadline_, trimDeadline_,
+                        reconfigDeadline_, heartbeatDeadline_ }) {
+            if (d >= 0 && (deadline < 0 || d < deadline))
+                deadline = d;
+        }
+        sink_->scheduleTimeout(deadline < 0 ? -1 : std::max(qint64(0), deadline - now()));
+    }
+
+    void AssociationCore::processTimeouts()
+    {
+        OutgoingBurst burst(this);
+        auto ts = now();
+        if (flushDeadline_ >= 0 && flushDeadline_ <= ts) {
+            flushDeadline_ = -1;
+            trySend();
+        }
+        if (pmtuDeadline_ >= 0 && pmtuDeadline_ <= ts) {
+            pmtuDeadline_ = -1;
+            pathMtuTimeout();
+        }
+        if (holdDeadline_ >= 0 && holdDeadline_ <= ts) {
+            holdDeadline_ = -1;
+            trySend();
+        }
+        if (sackDeadline_ >= 0 && sackDeadline_ <= ts) {
+            sendSack();
+        }
+        if (t3Deadline_ >= 0 && t3Deadline_ <= ts) {
+            t3Deadline_ = -1;
+            retransmissionTimeout();
+        }
+        if (reconfigDeadline_ >= 0 && reconfigDeadline_ <= ts) {
+            reconfigDeadline_ = -1;
+            sendStreamReset(); // repeats the outstanding request
+        }
+        if (heartbeatDeadline_ >= 0 && heartbeatDeadline_ <= ts) {
+            heartbeatDeadline_ = -1;
+            heartbeatTimeout();
+        }
+        if (trimDeadline_ >= 0 && trimDeadline_ <= ts) {
+            if (ts - lastActive_ >= idleTrimDelay_) {
+                trimDeadline_ = -1;
+                trimMemory();
+            } else {
+                trimDeadline_ = lastActive_ + idleTrimDelay_;
+            }
+        }
+        updateTimer();
+    }
+
+    void AssociationCore::sendSack()
+    {
+        if (ingesting_) {
+            sackDeferred_ = true;
+            return;
+        }
+        ackState      = 0;
+        sackDeadline_ = -1;
+
+        // gap blocks are offsets from the cumulative tsn
+        QList<SackChunk::Gap> gaps;
+        for (auto tsn : receivedTsns_) {
+            auto offset = quint16(tsn - lastRcvdTsn_);
+            if (!gaps.isEmpty() && gaps.last().end + 1 == offset) {
+                gaps.last().end = offset;
+            } else {
+                gaps.append({ offset, offset });
+            }
+        }
+        QList<quint32> dups;
+        for (auto tsn : duplicateTsns_) {
+            dups.append(tsn);
+        }
+        duplicateTsns_.clear();
+
+        lastAdvertisedCredit_ = advertisedCredit();
+        QByteArray raw;
+        if (peerNrSack_) {
+            // received data is never reneged on, so all the gaps go as non-renegable
+            const int size = NrSackChunk::MinHeaderSize + (gaps.size() + dups.size()) * 4;
+            raw.fill(0, size);
+            raw[0] = char(NrSackChunk::Type);
+            NrSackChunk sack { raw, 0, size };
+            sack.setLength(size);
+            sack.setCumulativeTSNAck(lastRcvdTsn_);
+            sack.setReceiverWindowCredit(lastAdvertisedCredit_);
+            sack.setNrGapAckBlocksCount(quint16(gaps.size()));
+            sack.setDuplicateTSNCount(quint16(dups.size()));
+            sack.setData({}, gaps, dups);
+        } else {
+            const int size = SackChunk::MinHeaderSize + (gaps.size() + dups.size()) * 4;
+            raw.fill(0, size);
+            raw[0] = char(SackChunk::Type);
+            SackChunk sack { raw, 0, size };
+            sack.setLength(size);
+            sack.setCumulativeTSNAck(lastRcvdTsn_);
+            sack.setReceiverWindowCredit(lastAdvertisedCredit_);
+            sack.setGapAckBlocksCount(quint16(gaps.size()));
+            sack.setDuplicateTSNCount(quint16(dups.size()));
+            sack.setData(gaps, dups);
+        }
+
+        controlSendQueue_.push_back({ 0, 0, raw });
+        trySend();
+    }
+
+    void AssociationCore::tuneReceiveWindow(quint64 desired)
+    {
+        desired = std::min(desired, quint64(maxReceiveWindow_));
+        if (desired <= localWindowCredit_) {
+            return; // never shrink. the sender may already rely on the credit
+        }
+        quint64 delta = desired - localWindowCredit_;
+        quint64 usage = receiveWindowUsage.load();
+        do {
+            auto limit = receiveWindowLimit.load();
+            if (usage >= limit) {
+                return;
+            }
+            delta = std::min(delta, limit - usage);
+        } while (!receiveWindowUsage.compare_exchange_weak(usage, usage + delta));
+        localWindowCredit_ += quint32(delta);
+    }
+
+    void AssociationCore::setReceiveWindowMemoryLimit(quint64 bytes) { receiveWindowLimit = bytes; }
+
+    quint64 AssociationCore::receiveWindowMemoryUsage() { return receiveWindowUsage; }
+
+    void AssociationCore::setBufferedMemoryLimit(quint64 bytes) { bufferedMemoryLimitBytes = bytes; }
+
+    quint64 AssociationCore::bufferedMemoryLimit() { return bufferedMemoryLimitBytes; }
+
+    quint64 AssociationCore::totalBufferedMemory() { return bufferedMemoryUsage; }
+
+    bool AssociationCore::chargeMemory(quint64 bytes, bool write)
+    {
+        // an association holding nothing may always take up to the limit, so a message larger than the fair share
+        // still gets through eventually. other writes stop at the pressure threshold, the rest is left to received
+        // data, which the peers were promised by the advertised windows
+        const auto limit = bufferedMemoryLimitBytes.load();
+        auto       usage = bufferedMemoryUsage.load();
+        do {
+            if (usage + bytes > limit) {
+                return false;
+            }
+            if (write && bufferedMemory_ && underMemoryPressure(usage + bytes, limit)) {
+                return false;
+            }
+        } while (!bufferedMemoryUsage.compare_exchange_weak(usage, usage + bytes));
+        bufferedMemory_ += bytes;
+        return true;
+    }
+
+    void AssociationCore::releaseMemory(quint64 bytes)
+    {
+        bufferedMemory_ -= bytes;
+        bufferedMemoryUsage -= bytes;
+    }
+
+    quint32 AssociationCore::advertisedCredit() const
+    {
+        quint64 credit = localWindowCredit_ > localUsedCredit_ ? localWindowCredit_ - localUsedCredit_ : 0;
+        const auto limit = bufferedMemoryLimitBytes.load();
+        const auto usage = bufferedMemoryUsage.load();
+        // writes may take the budget up to the pressure threshold at any time, only the rest is sure to be left
+        const auto taken = std::max(usage, limit - limit / 8);
+        credit           = std::min(credit, taken < limit ? limit - taken : 0);
+        if (underMemoryPressure(usage, limit)) {
+            const auto share = fairMemoryShare(limit);
+            credit           = std::min(credit, share > bufferedMemory_ ? share - bufferedMemory_ : 0);
+        }
+        return quint32(credit);
+    }
+
+    void AssociationCore::setEstablished()
+    {
+        state_ = State::Established;
+        if (heartbeatInterval_) {
+            heartbeatDeadline_ = now() + heartbeatInterval_;
+            updateTimer();
+        }
+        startPathMtuDiscovery();
+        sink_->onEstablished();
+    }
+
+    void AssociationCore::setMaxPathMtu(quint32 size)
+    {
+        maxMtu_ = std::max(size, BasePathMtu) & ~3u;
+        if (mtu_ > maxMtu_) {
+            mtu_ = maxMtu_;
+        }
+        if (state_ == State::Established) {
+            startPathMtuDiscovery();
+        }
+    }
+
+    void AssociationCore::startPathMtuDiscovery()
+    {
+        pmtuProbeSize_  = 0;
+        pmtuFailedSize_ = maxMtu_ + 4;
+        if (maxMtu_ <= BasePathMtu) {
+            pmtuPhase_    = PmtuPhase::Disabled;
+            pmtuDeadline_ = -1;
+            return;
+        }
+        // the first probe goes from the timer, so the handshake completes first
+        pmtuPhase_    = PmtuPhase::Base;
+        pmtuDeadline_ = now();
+        updateTimer();
+    }
+
+    quint32 AssociationCore::nextPathMtuProbeSize() const
+    {
+        if (mtu_ >= maxMtu_) {
+            return 0;
+        }
+        // try the ceiling first since it's likely fine on local links. then do binary search
+        if (pmtuFailedSize_ > maxMtu_) {
+            return maxMtu_;
+        }
+        quint32 size = ((mtu_ + pmtuFailedSize_) / 2) & ~3u;
+        return size >= mtu_ + PathMtuSearchStep ? size : 0;
+    }
+
+    void AssociationCore::sendPathMtuProbe(quint32 size)
+    {
+        if (size != pmtuProbeSize_) {
+            pmtuProbeSize_  = size;
+            pmtuProbeCount_ = 0;
+        }
+        pmtuProbeCount_++;
+        pmtuProbeNonce_ = random64();
+
+        Packet packet;
+        auto   hb   = packet.appendChunk<HeartbeatChunk>();
+        auto   info = hb.appendParameter<HeartbeatInfoParameter>(HeartbeatInfoParameter::MinHeaderSize - 4);
+        info.setNonce(pmtuProbeNonce_);
+        info.setTimestamp(now());
+        info.setProbeSize(size);
+        int padding = int(size) - packet.size() - PadChunk::MinHeaderSize;
+        if (padding >= 0) {
+            auto pad = packet.appendChunk<PadChunk>(padding);
+            pad.setData(PadChunk::MinHeaderSize, QByteArray(padding, 0));
+        }
+        populateHeader(packet);
+        outgoingPackets_.push_back(std::move(packet));
+        notifyOutgoing();
+
+        pmtuDeadline_ = now() + PathMtuProbeTimeout;
+        updateTimer();
+    }
+
+    void AssociationCore::continuePathMtuSearch()
+    {
+        auto size = nextPathMtuProbeSize();
+        if (size) {
+            sendPathMtuProbe(size);
+            return;
+        }
+        pmtuPhase_     = PmtuPhase::SearchComplete;
+        pmtuProbeSize_ = 0;
+        pmtuDeadline_  = now() + PathMtuRaiseTimeout;
+        updateTimer();
+    }
+
+    void AssociationCore::pathMtuTimeout()
+    {
+        if (state_ != State::Established || pmtuPhase_ == PmtuPhase::Disabled) {
+            return;
+        }
+        if (!pmtuProbeSize_) {
+            if (pmtuPhase_ == PmtuPhase::Base) {
+                sendPathMtuProbe(BasePathMtu);
+            } else if (pmtuPhase_ == PmtuPhase::Error) {
+                startPathMtuDiscovery();
+            } else { // raise timer. confirm current size first and then look for more
+                pmtuPhase_      = PmtuPhase::Searching;
+                pmtuFailedSize_ = maxMtu_ + 4;
+                sendPathMtuProbe(mtu_);
+            }
+            return;
+        }
+        if (pmtuProbeCount_ < MaxPathMtuProbes) {
+            sendPathMtuProbe(pmtuProbeSize_);
+            return;
+        }
+        // the size doesn't pass
+        auto failedSize = pmtuProbeSize_;
+        pmtuProbeSize_  = 0;
+        if (pmtuPhase_ == PmtuPhase::Base) {
+            pmtuPhase_    = PmtuPhase::Error;
+            pmtuDeadline_ = now() + PathMtuRaiseTimeout;
+            updateTimer();
+        } else if (failedSize <= mtu_) {
+            // black hole. the path doesn't pass what it used to. back off to the base
+            mtu_       = BasePathMtu;
+            pmtuPhase_ = PmtuPhase::Base;
+            sendPathMtuProbe(BasePathMtu);
+        } else {
+            pmtuFailedSize_ = failedSize;
+            continuePathMtuSearch();
+        }
+    }
+
+    QByteArray AssociationCore::makeStateCookie()
+    {
+        if (!cookieSecret_) {
+            cookieSecret_ = std::make_shared<CookieSecret>();
+        }
+        StateCookie cookie;
+        cookie.myVerificationTag    = myVerificationTag_;
+        cookie.peerVerificationTag  = peerVerificationTag_;
+        cookie.myInitialTsn         = nextTsn_;
+        cookie.peerInitialTsn       = lastRcvdTsn_ + 1;
+        cookie.peerWindowCredit     = remoteWindowCredit_;
+        cookie.inboundStreamsCount  = inboundStreamsCount_;
+        cookie.outboundStreamsCount = outboundStreamsCount_;
+        cookie.sourcePort           = sourcePort_;
+        cookie.destinationPort      = destinationPort_;
+        cookie.peerNrSack           = peerNrSack_;
+        cookie.peerReconfig         = peerReconfig_;
+        return cookieSecret_->makeCookie(cookie);
+    }
+
+    void AssociationCore::restore(const StateCookie &cookie)
+    {
+        myVerificationTag_    = cookie.myVerificationTag;
+        peerVerificationTag_  = cookie.peerVerificationTag;
+        nextTsn_              = cookie.myInitialTsn;
+        cumulativeTsnAck_     = nextTsn_ - 1;
+        lastRcvdTsn_          = cookie.peerInitialTsn - 1;
+        remoteWindowCredit_   = cookie.peerWindowCredit;
+        ssthresh_             = remoteWindowCredit_;
+        inboundStreamsCount_  = cookie.inboundStreamsCount;
+        outboundStreamsCount_ = cookie.outboundStreamsCount;
+        sourcePort_           = cookie.sourcePort;
+        destinationPort_      = cookie.destinationPort;
+        peerNrSack_           = cookie.peerNrSack;
+        peerReconfig_         = cookie.peerReconfig;
+        reconfigSeq_          = nextTsn_;
+        peerReconfigSeq_      = cookie.peerInitialTsn;
+        lastAdvertisedCredit_ = advertisedCredit();
+    }
+
+    void AssociationCore::acceptCookieEcho(const QByteArray &data, const StateCookie &cookie)
+    {
+        verifiedCookie_ = &cookie;
+        writeIncoming(data);
+        verifiedCookie_ = nullptr;
+    }
+
+    AssociationCore::AssociationCore(AssociationSink *sink, quint16 sourcePort, quint16 destinationPort) :
+        sink_(sink), sourcePort_(sourcePort), destinationPort_(destinationPort)
+    {
+        timer_.start();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        myVerificationTag_ = QRandomGenerator::global()->generate();
+#else
+        myVerificationTag_ = quint32(qrand());
+#endif
+        if (!myVerificationTag_)
+            myVerificationTag_++;
+        nextTsn_          = myVerificationTag_;
+        cumulativeTsnAck_ = nextTsn_ - 1;
+        reconfigSeq_      = nextTsn_;
+        receiveWindowUsage += localWindowCredit_;
+        associationsCount++;
+    }
+
+    AssociationCore::~AssociationCore()
+    {
+        receiveWindowUsage -= localWindowCredit_;
+        bufferedMemoryUsage -= bufferedMemory_;
+        associationsCount--;
+    }
+
+    Packet AssociationCore::initPacket() const
+    {
+        Packet packet;
+        auto   chunk = packet.appendChunk<InitChunk>();
+
+        chunk.setInitiateTag(myVerificationTag_);
+        chunk.setInitialTsn(nextTsn_);
+        chunk.setReceiverWindowCredit(advertisedCredit());
+        chunk.setInboundStreamsCount(inboundStreamsCount_);
+        chunk.setOutboundStreamsCount(outboundStreamsCount_);
+        chunk.appendParameter<SupportedExtensionsParameter>(supportedExtensions());
+        return packet;
+    }
+
+    QByteArray AssociationCore::localInit() const { return initPacket().takeData().mid(Packet::HeaderSize); }
+
+    bool AssociationCore::associateWithInit(const QByteArray &remoteInit)
+    {
+        if (state_ != State::Closed) {
+            qWarning("can't started associate on unclosed connection");
+            return false;
+        }
+        QByteArray raw = remoteInit;
+        InitChunk  chunk { raw, 0, raw.size() };
+        if (raw.size() < InitChunk::MinHeaderSize || chunk.type() != InitChunk::Type
+            || ((chunk.length() + 3) & ~3) != raw.size() || !chunk.initiateTag()) {
+            return false;
+        }
+        initRemote(chunk);
+        lastAdvertisedCredit_ = advertisedCredit();
+        setEstablished();
+        return true;
+    }
+
+    void AssociationCore::associate()
+    {
+        if (state_ != State::Closed) {
+            qWarning("can't started associate on unclosed connection");
+            return;
+        }
+
+        Packet packet         = initPacket();
+        state_                = State::CookieWait;
+        lastAdvertisedCredit_ = advertisedCredit();
+        handshakeStarted_     = now();
+        sendFirstPriority(packet);
+    }
+
+    void AssociationCore::abort(Error error)
+    {
+        error_ = error;
+        // TODO send abort
+        sink_->onErrorOccured();
+    }
+
+    void AssociationCore::setError(Error error)
+    {
+        error_ = error;
+        sink_->onErrorOccured();
+    }
+
+    AssociationCore::Message AssociationCore::readIncoming()
+    {
+        if (incomingMessages_.empty()) {
+            return Message();
+        }
+        Message message = takeIncoming();
+        consumeIncoming(message.streamId, quint32(message.data.size()));
+        return message;
+    }
+
+    AssociationCore::Message AssociationCore::takeIncoming()
+    {
+        if (incomingMessages_.empty()) {
+            return Message();
+        }
+        Message message = std::move(incomingMessages_.front());
+        incomingMessages_.pop_front();
+        return message;
+    }
+
+    void AssociationCore::consumeIncoming(quint16 streamId, quint32 bytes)
+    {
+        localUsedCredit_ -= bytes;
+        releaseMemory(quint64(bytes));
+        auto stream = inboundStreams_.find(streamId);
+        if (stream) {
+            stream->receivedAmount -= bytes;
+            stream->queuedAmount -= bytes;
+            releaseHeld(*stream);
+            if (stream->reset && !stream->receivedAmount && !stream->receiveLimit && stream->pending.empty()) {
+                inboundStreams_.erase(streamId); // the last message from before the stream reset
+            }
+        }
+        markActive();
+
+        // the application has read drainedBytes_ within the last round trip. to not stall the sender the window
+        // has to hold at least twice that (dynamic right-sizing)
+        auto ts = now();
+        if (ts - drainStarted_ >= std::max(srtt_ ? srtt_ : DefaultRtt, MinAutotuneInterval)) {
+            tuneReceiveWindow(quint64(drainedBytes_) * 2);
+            drainStarted_ = ts;
+            drainedBytes_ = 0;
+        }
+        drainedBytes_ += bytes;
+
+        // window update if the sender is likely to think the window is way smaller than it's now
+        quint32 credit = localWindowCredit_ - localUsedCredit_;
+        if (state_ == State::Established && credit >= 2 * lastAdvertisedCredit_
+            && credit - lastAdvertisedCredit_ >= mtu_) {
+            sendSack();
+        }
+    }
+
+    QByteArray AssociationCore::readOutgoing()
+    {
+        if (outgoingPackets_.empty()) {
+            return QByteArray();
+        }
+        QByteArray data = outgoingPackets_.front().takeData();
+        outgoingPackets_.pop_front();
+        return data;
+    }
+
+    int AssociationCore::readOutgoingBatch(PacketBatch &batch, int max)
+    {
+        auto count = outgoingPackets_.size();
+        if (max >= 0 && size_t(max) < count) {
+            count = size_t(max);
+        }
+        int total = batch.buffer.size();
+        for (size_t i = 0; i < count; i++) {
+            total += outgoingPackets_[i].size();
+        }
+        batch.buffer.reserve(total);
+        for (size_t i = 0; i < count; i++) {
+            const auto data = outgoingPackets_.front().takeData();
+            batch.segments.push_back({ batch.buffer.size(), data.size() });
+            batch.buffer.append(data);
+            outgoingPackets_.pop_front();
+        }
+        return int(count);
+    }
+
+    void AssociationCore::writeIncoming(const QByteArray &data)
+    {
+        const Packet pkt(data);
+        if (!pkt.isValidSctp()) {
+            return; // ignore non-sctp or broken sctp
+        }
+        OutgoingBurst burst(this);
+        auto verificationTag = pkt.verificationTag();
+        if (state_ != State::Closed && verificationTag != myVerificationTag_) {
+            return; // 8.5 discard silently. TODO review exception rules 8.5.1
+        }
+        markActive();
+        bool allowMoreChunks = true;
+        bool hasData         = false;
+        int  hundledChunks   = 0;
+        auto messagesCount   = incomingMessages_.size();
+        for (const auto &chunk : pkt) {
+            if (!chunk.isValid() || !allowMoreChunks) {
+                abort(Error::ProtocolViolation);
+                return;
+            }
+            switch (chunk.type()) {
+            case InitChunk::Type:
+                if (verificationTag) {
+                    abort(Error::VerificationTag);
+                    return;
+                }
+                if (hundledChunks) {
+                    abort(Error::ProtocolViolation);
+                    return;
+                }
+                allowMoreChunks  = false;
+                sourcePort_      = pkt.destinationPort();
+                destinationPort_ = pkt.sourcePort();
+                incomingChunk(chunk.as<InitChunk>());
+                break;
+            case InitAckChunk::Type:
+                if (hundledChunks) {
+                    abort(Error::ProtocolViolation);
+                    return;
+                }
+                allowMoreChunks = false;
+                incomingChunk(chunk.as<InitAckChunk>());
+                break;
+            case CookieEchoChunk::Type:
+                incomingChunk(chunk.as<CookieEchoChunk>(), verificationTag);
+                break;
+            case CookieAckChunk::Type:
+                incomingChunk(chunk.as<CookieAckChunk>());
+                break;
+            case SackChunk::Type:
+                incomingChunk(chunk.as<SackChunk>());
+                break;
+            case NrSackChunk::Type:
+                incomingChunk(chunk.as<NrSackChunk>());
+                break;
+            case DataChunk::Type:
+                hasData = true;
+                incomingChunk(chunk.as<DataChunk>());
+                break;
+            case HeartbeatChunk::Type:
+                incomingChunk(chunk.as<HeartbeatChunk>());
+                break;
+            case HeartbeatAckChunk::Type:
+                incomingChunk(chunk.as<HeartbeatAckChunk>());
+                break;
+            case ReconfigChunk::Type:
+                incomingChunk(chunk.as<ReconfigChunk>());
+                break;
+            }
+
+            hundledChunks++;
+        }
+
+        if (hasData && state_ == State::Established) {
+            if (++ackState >= DelayedAckPackets || !receivedTsns_.empty() || !duplicateTsns_.empty()) {
+                sendSack();
+            } else if (sackDeadline_ < 0) {
+                sackDeadline_ = now() + DelayedAckTimeout;
+                updateTimer();
+            }
+        }
+        if (incomingMessages_.size() != messagesCount) {
+            if (ingesting_) {
+                incomingNotify_ = true;
+            } else {
+                sink_->onReadyReadIncoming();
+            }
+        }
+    }
+
+    void AssociationCore::writeIncoming(const QList<QByteArray> &packets)
+    {
+        OutgoingBurst burst(this);
+        ingesting_ = true;
+        for (const auto &data : packets) {
+            writeIncoming(data);
+        }
+        ingesting_ = false;
+
+        // the flags are cleared whatever the state is, so a stale one doesn't fire in some later batch
+        const bool sack = sackDeferred_;
+        const bool send = sendDeferred_;
+        sackDeferred_   = false;
+        sendDeferred_   = false;
+        const bool receiving = state_ == State::Established || state_ == State::ShutdownPending
+            || state_ == State::ShutdownSent; // DATA is accepted, so it's acked
+        if (sack && receiving) {
+            sendSack(); // sends the rest too
+        } else if (send) {
+            trySend();
+        }
+        if (incomingNotify_) {
+            incomingNotify_ = false;
+            sink_->onReadyReadIncoming();
+        }
+    }
+
+    bool AssociationCore::write(quint16 streamId, bool unordered, const QByteArray &payloadProto, const QByteArray &data)
+    {
+        if (state_ == State::Closed || state_ == State::ShutdownSent || state_ == State::ShutdownAckSent) {
+            setError(Error::WrongState);
+            return false;
+        }
+        if (streamId >= outboundStreamsCount_) {
+            setError(Error::WrongState); // the peer would acknowledge and throw it away. rfc 4960 6.5
+            return false;
+        }
+        if (resettingStream(streamId)) {
+            return false;
+        }
+        markActive();
+        auto &     stream    = outboundStreams_[streamId];
+        const auto sendLimit = stream.sendLimit ? stream.sendLimit : streamSendLimit_;
+        if (sendLimit && stream.bufferedAmount && stream.bufferedAmount + quint64(data.size()) > sendLimit) {
+            return false;
+        }
+        const int maxPayload = int(mtu_) - Packet::HeaderSize - DataChunk::MinHeaderSize;
+        auto      chunkSize  = [](int payload) { return (DataChunk::MinHeaderSize + payload + 3) & ~3; };
+        quint64   queued     = quint64(data.size() / maxPayload) * quint64(chunkSize(maxPayload));
+        if (data.size() % maxPayload) {
+            queued += quint64(chunkSize(data.size() % maxPayload));
+        }
+        if (!chargeMemory(queued, true)) {
+            return false;
+        }
+        int offset = 0;
+        while (offset < data.size()) {
+            auto       toTake = std::min(data.size() - offset, maxPayload);
+            UnackChunk transfer;
+            transfer.data.resize(chunkSize(toTake));
+            transfer.data[0] = char(DataChunk::Type);
+            std::fill(transfer.data.begin() + DataChunk::MinHeaderSize + toTake, transfer.data.end(), 0); // padding
+            DataChunk chunk { transfer.data, 0, transfer.data.size() };
+            chunk.setFlags(0);
+            chunk.setUnordered(unordered);
+            chunk.setBeginning(offset == 0);
+            chunk.setEnding(offset + toTake == data.size());
+            chunk.setUserData(QByteArray::fromRawData(data.constData() + offset, toTake));
+            chunk.setPayloadProtocol(payloadProto);
+            chunk.setStreamIdentifier(streamId);
+            if (!unordered) {
+                chunk.setStreamSequenceNumber(stream.nextSsn);
+            }
+            dataQueuedBytes_ += transfer.data.size();
+            dataSendQueue_.push_back(transfer); // tsn is assigned when sent
+            offset += toTake;
+        }
+        if (!unordered && data.size()) {
+            stream.nextSsn++; // unordered messages don't consume sequence numbers
+        }
+        stream.bufferedAmount += data.size();
+        bufferedAmount_ += data.size();
+
+        if (batchDepth_)
+            return true; // endBatch() will send it
+        if (nagleDelay_ && dataQueuedBytes_ < mtu_ - Packet::HeaderSize) {
+            if (flushDeadline_ < 0) {
+                flushDeadline_ = now() + nagleDelay_;
+                updateTimer();
+            }
+            return true;
+        }
+        trySend();
+        return true;
+    }
+
+    void AssociationCore::beginBatch() { batchDepth_++; }
+
+    void AssociationCore::endBatch()
+    {
+        Q_ASSERT(batchDepth_ > 0);
+        if (--batchDepth_ == 0) {
+            trySend();
+        }
+    }
+
+    void AssociationCore::incomingChunk(const InitChunk &chunk)
+    {
+        initRemote(chunk);
+        if (peerVerificationTag_ == 0) {
+            abort(Error::VerificationTag);
+            return;
+        }
+
+        Packet packet;
+        auto   ack = packet.appendChunk<InitAckChunk>();
+
+        ack.setInitiateTag(myVerificationTag_);
+        ack.setInitialTsn(nextTsn_);
+        lastAdvertisedCredit_ = advertisedCredit();
+        ack.setReceiverWindowCredit(lastAdvertisedCredit_);
+        ack.setInboundStreamsCount(inboundStreamsCount_);
+        ack.setOutboundStreamsCount(outboundStreamsCount_);
+        ack.appendParameter<SupportedExtensionsParameter>(supportedExtensions());
+        ack.appendParameter<CookieParameter>(makeStateCookie());
+        handshakeStarted_     = now();
+
+        // the TCB is restored from the cookie on COOKIE-ECHO, so nothing here is required to be kept. use Listener to
+        // not allocate associations for INITs at all
+        sendFirstPriority(packet);
+    }
+
+    void AssociationCore::initRemote(const InitChunk &chunk)
+    {
+        lastRcvdTsn_          = chunk.initialTsn() - 1;
+        peerVerificationTag_  = chunk.initiateTag();
+        remoteWindowCredit_   = chunk.receiverWindowCredit();
+        ssthresh_             = remoteWindowCredit_;
+        inboundStreamsCount_  = std::min(inboundStreamsCount_, chunk.outboundStreamsCount());
+        outboundStreamsCount_ = std::min(outboundStreamsCount_, chunk.inboundStreamsCount());
+        const auto extensions = chunk.parameter<SupportedExtensionsParameter>();
+        peerNrSack_           = extensions.isValid() && extensions.value().contains(char(NrSackChunk::Type));
+        peerReconfig_         = extensions.isValid() && extensions.value().contains(char(ReconfigChunk::Type));
+        peerReconfigSeq_      = chunk.initialTsn();
+        cwnd_                 = std::min(4 * mtu_, std::max(2 * mtu_, 4380u));
+    }
+
+    void AssociationCore::incomingChunk(const InitAckChunk &chunk)
+    {
+        const auto cookie = chunk.parameter<CookieParameter>();
+        if (!cookie.isValid()) {
+            abort(Error::InvalidCookie);
+            return;
+        }
+
+        if (state_ != State::CookieWait) {
+            return; // RFC 4960 5.2.3. discard
+        }
+
+        initRemote(chunk);
+        updateRtt(now() - handshakeStarted_);
+
+        // COOKIE-ECHO goes first and whatever was written meanwhile is bundled with it
+        Packet packet;
+        packet.appendChunk<CookieEchoChunk>(cookie.value());
+        state_ = State::CookieEchoed;
+        controlSendQueue_.push_front({ 0, 0, packet.takeData().mid(Packet::HeaderSize) });
+        trySend();
+    }
+
+    void AssociationCore::incomingChunk(const CookieEchoChunk &chunk, quint32 verificationTag)
+    {
+        StateCookie cookie;
+        if (verifiedCookie_) {
+            cookie = *verifiedCookie_;
+        } else if (!cookieSecret_ || !cookieSecret_->openCookie(chunk.value(), cookie)) {
+            abort(Error::InvalidCookie);
+            return;
+        }
+        if (cookie.myVerificationTag != verificationTag) {
+            return; // RFC 4960 5.1.5. discard
+        }
+        if (state_ == State::Closed) {
+            restore(cookie); // the TCB might have been freed after INIT-ACK
+        }
+
+        Packet packet;
+        packet.appendChunk<CookieAckChunk>();
+        sendFirstPriority(packet);
+        if (state_ != State::CookieWait && state_ != State::CookieEchoed && state_ != State::Closed) {
+            return; // a duplicate, our COOKIE-ACK was likely lost. the association is up already
+        }
+
+        if (handshakeStarted_) {
+            updateRtt(now() - handshakeStarted_);
+        } else if (cookie.age) {
+            updateRtt(cookie.age); // INIT-ACK went out when the cookie was made
+        }
+        setEstablished();
+    }
+
+    void AssociationCore::incomingChunk(const CookieAckChunk &)
+    {
+        if (state_ == State::CookieEchoed) {
+            setEstablished();
+        }
+    }
+
+    template <class Sack> void AssociationCore::processSack(const Sack &chunk)
+    {
+        if (!(state_ == State::Established || state_ == State::ShutdownPending || state_ == State::ShutdownReceived)) {
+            return; // we don't care
+        }
+        errorCount_        = 0; // RFC 4960 8.3. the peer is alive
+        auto cumulativeAck = chunk.cumulativeTSNAck();
+        if (serialLess(cumulativeAck, cumulativeTsnAck_)) {
+            return; // out of order. the window in it is outdated too
+        }
+        const bool   advanced = cumulativeAck != cumulativeTsnAck_;
+        const auto   inFlight = remoteUsedCredit_;
+        const auto   ts       = now();
+        quint32      acked    = 0;
+        auto         release  = [this, &acked](UnackChunk &chunk) {
+            if (chunk.retransmit) {
+                retransmitCount_--;
+            } else if (!chunk.gapAcked) {
+                remoteUsedCredit_ -= userDataSize(chunk.data);
+                acked += userDataSize(chunk.data);
+            }
+        };
+        cumulativeTsnAck_ = cumulativeAck;
+
+        auto it = unacknowledgedChunks.begin();
+        while (it != unacknowledgedChunks.end() && !serialLess(cumulativeAck, it->first)) {
+            if (rttMeasuring_ && it->first == rttTsn_) {
+                rttMeasuring_ = false;
+                updateRtt(ts - it->second.timestamp);
+            }
+            release(it->second);
+            releaseMemory(quint64(it->second.data.size()));
+            it = unacknowledgedChunks.erase(it);
+        }
+        // gap blocks are offsets from the cumulative ack. malformed ones are skipped, the rest is walked over the
+        // chunks we have rather than tsn by tsn
+        auto gapChunks = [this, cumulativeAck](const SackChunk::Gap &gap) {
+            if (!gap.begin || gap.begin > gap.end) {
+                return std::make_pair(unacknowledgedChunks.end(), unacknowledgedChunks.end());
+            }
+            return std::make_pair(unacknowledgedChunks.lower_bound(cumulativeAck + gap.begin),
+                                  unacknowledgedChunks.upper_bound(cumulativeAck + gap.end));
+        };
+        for (const auto &gap : chunk.gaps()) {
+            for (auto range = gapChunks(gap); range.first != range.second; ++range.first) {
+                auto &c = range.first->second;
+                if (!c.gapAcked) {
+                    release(c);
+                    c.gapAcked   = true;
+                    c.retransmit = false;
+                }
+            }
+        }
+        // the peer won't renege on these, so they are done with
+        for (const auto &gap : nrGaps(chunk)) {
+            for (auto range = gapChunks(gap); range.first != range.second;) {
+                auto &c = range.first->second;
+                if (!c.gapAcked) {
+                    release(c);
+                }
+                if (rttMeasuring_ && range.first->first == rttTsn_) {
+                    rttMeasuring_ = false;
+                }
+                stats_.bytesFreedEarly += quint64(c.data.size());
+                releaseMemory(quint64(c.data.size()));
+                range.first = unacknowledgedChunks.erase(range.first);
+            }
+        }
+
+        // RFC 4960 6.2.1. what's still in flight isn't accounted by the peer yet
+        remoteWindowCredit_ = chunk.receiverWindowCredit();
+
+        // the window opened while a probe is unacknowledged. it's resent right away instead of holding the data
+        // sent after it until T3
+        if (remoteWindowCredit_ && !unacknowledgedChunks.empty()) {
+            auto &first = unacknowledgedChunks.begin()->second;
+            if (first.probe && !first.gapAcked && !first.retransmit) {
+                first.probe      = false;
+                first.retransmit = true;
+                retransmitCount_++;
+                remoteUsedCredit_ -= userDataSize(first.data);
+            }
+        }
+
+        // RFC 4960 7.2.1 and 7.2.2
+        if (advanced && inFlight >= cwnd_) {
+            if (cwnd_ <= ssthresh_) {
+                cwnd_ += std::min(acked, mtu_);
+            } else {
+                partialBytesAcked += acked;
+                if (partialBytesAcked >= cwnd_) {
+                    partialBytesAcked -= cwnd_;
+                    cwnd_ += mtu_;
+                }
+            }
+        }
+        if (unacknowledgedChunks.empty()) {
+            partialBytesAcked = 0;
+            t3Deadline_       = -1;
+        } else if (advanced) {
+            t3Deadline_ = ts + rto_;
+        }
+        updateTimer();
+        trySend();
+    }
+
+    void AssociationCore::incomingChunk(const SackChunk &chunk)
+    {
+        const int blocks = chunk.gapAckBlocksCount() + chunk.duplicateTSNCount();
+        if (chunk.length() < SackChunk::MinHeaderSize + blocks * 4) {
+            return; // the blocks don't fit
+        }
+        processSack(chunk);
+    }
+
+    void AssociationCore::incomingChunk(const NrSackChunk &chunk)
+    {
+        const int blocks = chunk.gapAckBlocksCount() + chunk.nrGapAckBlocksCount() + chunk.duplicateTSNCount();
+        if (chunk.length() < NrSackChunk::MinHeaderSize + blocks * 4) {
+            return; // the blocks don't fit
+        }
+        processSack(chunk);
+    }
+
+    void AssociationCore::incomingChunk(const DataChunk &chunk)
+    {
+        if (!(state_ == State::Established || state_ == State::ShutdownPending || state_ == State::ShutdownSent)) {
+            return; // we don't care
+        }
+        if (!chunk.isValid() || chunk.length() <= DataChunk::MinHeaderSize) {
+            return;
+        }
+        const quint32 tsn = chunk.tsn();
+        if (!serialLess(lastRcvdTsn_, tsn) || receivedTsns_.count(tsn)) {
+            if (duplicateTsns_.size() < MaxReportedDuplicates) {
+                duplicateTsns_.push_back(tsn);
+            }
+            return;
+        }
+        // every chunk takes at least a byte of the window, so a tsn further than that is bogus. gap blocks can't
+        // report more than 16 bits of offset from the cumulative tsn either
+        if (tsn - lastRcvdTsn_ > std::min(localWindowCredit_, quint32(0xffff))) {
+            return;
+        }
+        if (chunk.streamIdentifier() >= inboundStreamsCount_) {
+            receivedTsn(tsn); // acknowledged but thrown away. rfc 4960 6.5
+            return;
+        }
+        // RFC 4960 6.2. a full window or memory budget still takes chunks filling gaps, otherwise a partly received
+        // message could hold what's left of either and never complete, with the sender's memory stuck as well
+        const auto userData = chunk.userData();
+        const bool fillsGap = !receivedTsns_.empty() && serialLess(tsn, *receivedTsns_.rbegin());
+        if (fillsGap) {
+            bufferedMemory_ += quint64(userData.size());
+            bufferedMemoryUsage += quint64(userData.size());
+        } else if (localUsedCredit_ + quint32(userData.size()) > localWindowCredit_
+                   || !chargeMemory(quint64(userData.size()), false)) {
+            ackState = DelayedAckPackets; // no room. let the sender know our window asap
+            return;
+        }
+
+        // the chunk references the packet buffer, so make a deep copy
+        const auto proto = chunk.payloadProtocol();
+        fragments_.emplace(tsn,
+                           IncomingFragment { chunk.streamIdentifier(), chunk.streamSequenceNumber(), chunk.flags(),
+                                              QByteArray(proto.constData(), proto.size()),
+                                              QByteArray(userData.constData(), userData.size()) });
+        auto &stream = inboundStreams_[chunk.streamIdentifier()];
+        localUsedCredit_ += userData.size();
+        stream.receivedAmount += userData.size();
+        stream.reset = false;
+        tryReassemble(tsn);
+        receivedTsn(tsn);
+    }
+
+    void AssociationCore::receivedTsn(quint32 tsn)
+    {
+        if (tsn == lastRcvdTsn_ + 1) {
+            lastRcvdTsn_ = tsn;
+            while (!receivedTsns_.empty() && *receivedTsns_.begin() == lastRcvdTsn_ + 1) {
+                lastRcvdTsn_++;
+                receivedTsns_.erase(receivedTsns_.begin());
+            }
+        } else {
+            receivedTsns_.insert(tsn);
+        }
+        if (streamReset_ && streamReset_->deferring && !serialLess(lastRcvdTsn_, streamReset_->deferredTsn)) {
+            finishDeferredReset();
+        }
+    }
+
+    void AssociationCore::tryReassemble(quint32 tsn)
+    {
+        // look for the first and the last fragments of the message and ensure nothing is missed in between
+        const auto &fragment = fragments_.find(tsn)->second;
+        quint32     first    = tsn;
+        for (auto it = fragments_.find(first); !(it->second.flags & DataChunk::BeginningFlag);) {
+            it = fragments_.find(first - 1);
+            if (it == fragments_.end() || it->second.streamId != fragment.streamId) {
+                return;
+            }
+            first--;
+        }
+        quint32 last = tsn;
+        for (auto it = fragments_.find(last); !(it->second.flags & DataChunk::EndingFlag);) {
+            it = fragments_.find(last + 1);
+            if (it == fragments_.end() || it->second.streamId != fragment.streamId) {
+                return;
+            }
+            last++;
+        }
+
+        auto    it = fragments_.find(first);
+        Message message;
+        message.streamId     = it->second.streamId;
+        message.unordered    = it->second.flags & DataChunk::UnorderedFlag;
+        message.payloadProto = it->second.payloadProto;
+        quint16 ssn          = it->second.ssn;
+        if (first == last) {
+            message.data = std::move(it->second.data);
+            fragments_.erase(it);
+        } else {
+            int size = 0;
+            for (auto i = it; i != fragments_.end() && i->first != last + 1; ++i) {
+                size += i->second.data.size();
+            }
+            message.data.reserve(size);
+            while (it != fragments_.end() && it->first != last + 1) {
+                message.data.append(it->second.data);
+                it = fragments_.erase(it);
+            }
+        }
+
+        auto &stream = inboundStreams_[message.streamId];
+        if (message.unordered) {
+            deliver(stream, std::move(message));
+            return;
+        }
+        if (ssn != stream.nextSsn) {
+            stream.pending.emplace(ssn, std::move(message));
+            return;
+        }
+        deliver(stream, std::move(message));
+        stream.nextSsn++;
+        auto pending = stream.pending.begin();
+        while (pending != stream.pending.end() && pending->first == stream.nextSsn) {
+            deliver(stream, std::move(pending->second));
+            pending = stream.pending.erase(pending);
+            stream.nextSsn++;
+        }
+    }
+
+    void AssociationCore::deliver(InboundStream &stream, Message &&message)
+    {
+        stream.held.push_back(std::move(message));
+        releaseHeld(stream);
+    }
+
+    void AssociationCore::releaseHeld(InboundStream &stream)
+    {
+        // at least one message of the stream is always readable, so the stream can't stall on a large message
+        const auto limit = stream.receiveLimit ? stream.receiveLimit : streamReceiveLimit_;
+        while (!stream.held.empty()) {
+            const auto size = quint32(stream.held.front().data.size());
+            if (limit && stream.queuedAmount && stream.queuedAmount + size > limit) {
+                break;
+            }
+            stream.queuedAmount += size;
+            incomingMessages_.push_back(std::move(stream.held.front()));
+            stream.held.pop_front();
+        }
+    }
+
+    void AssociationCore::incomingChunk(const HeartbeatChunk &chunk)
+    {
+        if (state_ != State::Established) {
+            return;
+        }
+        const auto info = chunk.parameter<HeartbeatInfoParameter>();
+        if (!info.isValid()) {
+            return;
+        }
+        // reply with the info only. padding of path mtu probes is not echoed back
+        Packet packet;
+        packet.appendChunk<HeartbeatAckChunk>().appendParameter<HeartbeatInfoParameter>(info.value());
+        sendFirstPriority(packet);
+    }
+
+    void AssociationCore::incomingChunk(const HeartbeatAckChunk &chunk)
+    {
+        const auto info = chunk.parameter<HeartbeatInfoParameter>();
+        if (!info.isValid(HeartbeatInfoParameter::MinHeaderSize)) {
+            return;
+        }
+        if (!info.probeSize()) {
+            if (!heartbeatNonce_ || info.nonce() != heartbeatNonce_) {
+                return; // stale or not ours
+            }
+            heartbeatNonce_ = 0;
+            errorCount_     = 0;
+            const auto ts   = now();
+            if (ts >= info.timestamp()) {
+                updateRtt(ts - info.timestamp());
+            }
+            heartbeatDeadline_ = ts + heartbeatInterval_;
+            updateTimer();
+            return;
+        }
+        if (!pmtuProbeSize_ || info.nonce() != pmtuProbeNonce_ || info.probeSize() != pmtuProbeSize_) {
+            return; // stale or not ours
+        }
+        errorCount_    = 0;
+        mtu_           = std::max(mtu_, pmtuProbeSize_);
+        pmtuProbeSize_ = 0;
+        pmtuPhase_     = PmtuPhase::Searching;
+        continuePathMtuSearch();
+    }
+
+    void AssociationCore::incomingChunk(const ReconfigChunk &chunk)
+    {
+        if (state_ != State::Established) {
+            return;
+        }
+        // RFC 6525 5.2. requests are numbered. a repeated one gets the same answer again
+        auto inSequence = [this](quint32 seq) {
+            if (seq == peerReconfigSeq_ - 1) {
+                sendReconfigResponse(seq, peerReconfigResult_);
+                return false;
+            }
+            if (seq != peerReconfigSeq_) {
+                sendReconfigResponse(seq, ReconfigResponseParameter::BadSequenceNumber);
+                return false;
+            }
+            if (streamReset_ && streamReset_->deferring) {
+                sendReconfigResponse(seq, ReconfigResponseParameter::RequestInProgress);
+                return false;
+            }
+            return true;
+        };
+        for (const auto &param : chunk) {
+            if (!param.isValid()) {
+                return;
+            }
+            if (param.type() == OutgoingSsnResetRequestParameter::Type) {
+                const auto &request = static_cast<const OutgoingSsnResetRequestParameter &>(param);
+                if (param.size >= OutgoingSsnResetRequestParameter::MinHeaderSize
+                    && inSequence(request.requestSequence())) {
+                    incomingResetRequest(request);
+                }
+            } else if (param.type() == ReconfigResponseParameter::Type) {
+                const auto &response = static_cast<const ReconfigResponseParameter &>(param);
+                if (param.size < ReconfigResponseParameter::MinHeaderSize || !streamReset_
+                    || streamReset_->request.isEmpty() || response.responseSequence() != reconfigSeq_) {
+                    continue; // stale
+                }
+                auto &     reset  = *streamReset_;
+                const auto result = response.result();
+                if (result == ReconfigResponseParameter::InProgress
+                    || result == ReconfigResponseParameter::RequestInProgress) {
+                    reconfigDeadline_ = now() + rto_; // to be asked again
+                    updateTimer();
+                    continue;
+                }
+                const auto streams = toList(reset.requested);
+                reconfigSeq_++;
+                reset.request.clear();
+                reset.requested.clear();
+                reconfigDeadline_ = -1;
+                updateTimer();
+                if (result == ReconfigResponseParameter::Performed
+                    || result == ReconfigResponseParameter::NothingToDo) {
+                    resetOutboundStreams(streams);
+                    sink_->onOutgoingStreamsReset(streams);
+                }
+                if (reset.request.isEmpty() && !reset.pending.empty()) {
+                    sendStreamReset();
+                }
+                releaseStreamReset();
+            } else if (isUnsupportedReconfigRequest(param.type()) && param.size >= 8) {
+                const auto seq = qFromBigEndian<quint32>(param.data.constData() + param.offset + 4);
+                if (inSequence(seq)) {
+                    peerReconfigSeq_++;
+                    peerReconfigResult_ = ReconfigResponseParameter::Denied;
+                    sendReconfigResponse(seq, peerReconfigResult_);
+                }
+            }
+        }
+    }
+
+    void AssociationCore::incomingResetRequest(const OutgoingSsnResetRequestParameter &request)
+    {
+        const auto seq     = request.requestSequence();
+        const auto streams = request.streams();
+        peerReconfigSeq_++;
+        if (serialLess(lastRcvdTsn_, request.lastAssignedTsn())) {
+            // RFC 6525 5.2.2. the data sent before the request has to be delivered first
+            auto &reset       = streamReset();
+            reset.deferring   = true;
+            reset.deferredTsn = request.lastAssignedTsn();
+            reset.deferredSeq = seq;
+            reset.deferred.assign(streams.begin(), streams.end());
+            peerReconfigResult_ = ReconfigResponseParameter::InProgress;
+            sendReconfigResponse(seq, peerReconfigResult_);
+            return;
+        }
+        resetInboundStreams(streams);
+        peerReconfigResult_ = ReconfigResponseParameter::Performed;
+        sendReconfigResponse(seq, peerReconfigResult_);
+        sink_->onIncomingStreamsReset(streams);
+    }
+
+    void AssociationCore::finishDeferredReset()
+    {
+        auto &     reset   = *streamReset_;
+        const auto streams = toList(reset.deferred);
+        const auto seq     = reset.deferredSeq;
+        reset.deferring    = false;
+        reset.deferred.clear();
+        releaseStreamReset();
+        resetInboundStreams(streams);
+        peerReconfigResult_ = ReconfigResponseParameter::Performed;
+        sendReconfigResponse(seq, peerReconfigResult_); // not waiting for the request to be repeated
+        sink_->onIncomingStreamsReset(streams);
+    }
+
+    void AssociationCore::releaseStreamReset()
+    {
+        const auto &reset = *streamReset_;
+        if (reset.pending.empty() && reset.requested.empty() && reset.request.isEmpty() && !reset.deferring) {
+            streamReset_.reset();
+        }
+    }
+
+}}
@@ -0,0 +1,559 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include "sctp_common.h"
+#include "sctp_containers.h"
+
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QList>
+#include <QtEndian>
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace SctpDc { namespace Sctp {
+
+    class InitChunk;
+    class InitAckChunk;
+    class CookieEchoChunk;
+    class CookieAckChunk;
+    class SackChunk;
+    class NrSackChunk;
+    class DataChunk;
+    class HeartbeatChunk;
+    class HeartbeatAckChunk;
+    class ReconfigChunk;
+    class OutgoingSsnResetRequestParameter;
+    class Association;
+    class CookieSecret;
+    class Endpoint;
+    class Listener;
+    struct StateCookie;
+
+    // Events of AssociationCore. Called synchronously from within the core's methods, so the core may be used right
+    // from the handlers, e.g. to read the packets or to write more.
+    class AssociationSink {
+    public:
+        virtual ~AssociationSink() = default;
+
+        virtual void onReadyReadOutgoing() { }
+        virtual void onReadyReadIncoming() { }
+        virtual void onErrorOccured() { }
+        virtual void onEstablished() { }
+        virtual void onBufferedAmountLow() { }
+        virtual void onStreamBufferedAmountLow(quint16 streamId) { Q_UNUSED(streamId) }
+        // the peer reset its outgoing streams, so these incoming ones start over. empty means all of them. messages
+        // received before the reset may be still unread
+        virtual void onIncomingStreamsReset(const QList<quint16> &streamIds) { Q_UNUSED(streamIds) }
+        // resetStreams() is done and the streams may be used again
+        virtual void onOutgoingStreamsReset(const QList<quint16> &streamIds) { Q_UNUSED(streamIds) }
+
+        // processTimeouts() has to be called in usecs microseconds. replaces the previous request. -1 cancels it
+        virtual void scheduleTimeout(qint64 usecs) = 0;
+    };
+
+    // The protocol machine of an association without any QObject. Events go to the sink as plain virtual calls, the
+    // owner drives time by calling processTimeouts() when asked to. Association wraps it for the Qt world.
+    class AssociationCore {
+    public:
+        enum class State : quint8 {
+            Closed,
+            CookieWait,
+            CookieEchoed,
+            Established,
+            ShutdownPending,
+            ShutdownSent,
+            ShutdownReceived,
+            ShutdownAckSent
+        };
+
+        enum class Error : quint8 {
+            None,
+            WrongState,
+            ProtocolViolation,
+            VerificationTag,
+            InvalidCookie,
+            PeerUnreachable,
+            Unknown
+        };
+
+        constexpr static quint32 InitialReceiveWindow = 64 * 1024;
+
+        // time is in microseconds
+        struct Statistics {
+            qint64  windowLimitedTime      = 0; // data was queued but the peer's receive window was full
+            qint64  congestionLimitedTime  = 0; // data was queued but the congestion window was full
+            quint64 zeroWindowProbes       = 0;
+            quint64 retransmissionTimeouts = 0;
+            quint64 bytesFreedEarly        = 0; // chunks freed on NR-SACK before the cumulative ack passed them
+        };
+
+        // reassembled user message
+        struct Message {
+            quint16    streamId  = 0;
+            bool       unordered = false;
+            QByteArray payloadProto;
+            QByteArray data;
+        };
+
+        AssociationCore(AssociationSink *sink, quint16 sourcePort, quint16 destinationPort);
+        ~AssociationCore();
+
+        AssociationCore(const AssociationCore &) = delete;
+        AssociationCore &operator=(const AssociationCore &) = delete;
+
+        void  associate();
+
+        // SCTP Negotiation Acceleration Protocol (draft-ietf-tsvwg-sctp-snap). Both sides exchange their INIT chunks out
+        // of band (e.g. in SDP) and then the association is established right away without the 4-way handshake.
+        // Returns false if the remote INIT is malformed or the association is already started.
+        QByteArray localInit() const;
+        bool       associateWithInit(const QByteArray &remoteInit);
+        void  abort(Error error);
+        State state() const { return state_; }
+        Error error() const { return error_; }
+        // stream ids below it may be written to. the peer's limit once negotiated
+        quint16 outboundStreamsCount() const { return outboundStreamsCount_; }
+
+        // read payload extracted from sctp
+        QByteArray readOutgoing();
+        // appends up to max (all if negative) ready packets to the batch. returns the number of packets appended.
+        // onReadyReadOutgoing() comes once per burst of packets, so it's the way to drain them.
+        int readOutgoingBatch(PacketBatch &batch, int max = -1);
+
+        // data - an sctp packet right from network. note only sctp and its payload, nothing else
+        void writeIncoming(const QByteArray &data);
+        // a batch of packets, e.g. from recvmmsg(). SACK, sending and notifications are deferred to the end of the
+        // batch, so one cumulative SACK and one onReadyReadIncoming() cover it all
+        void writeIncoming(const QList<QByteArray> &packets);
+
+        // read next message received from the remote side. the returned message has null data if nothing to read
+        Message readIncoming();
+        bool    hasPendingMessages() const { return !incomingMessages_.empty(); }
+        // readIncoming() for applications queueing the messages on their own. The message stays accounted to the
+        // receive window, the memory budget and the stream receive limit until consumeIncoming() is called for its
+        // bytes, as they are read from the application's queue. Consuming may make held back messages readable.
+        Message takeIncoming();
+        void    consumeIncoming(quint16 streamId, quint32 bytes);
+
+        // returns false if the message is refused: in a wrong state, on a stream the peer doesn't accept or out of
+        // the buffered memory budget
+        bool write(quint16 streamId, bool unordered, const QByteArray &payloadProto, const QByteArray &data);
+
+        // Corking. Messages written between beginBatch() and endBatch() are only queued and then bundled densely
+        // into as few packets as possible when the outermost endBatch() is called. Calls may be nested.
+        void beginBatch();
+        void endBatch();
+
+        // Nagle-like mode. Small writes are held for up to usecs microseconds so following writes can share the
+        // packet. As soon as a full packet worth of data is queued it's sent without waiting. 0 disables the mode.
+        void setNagleDelay(int usecs) { nagleDelay_ = usecs; }
+        int  nagleDelay() const { return nagleDelay_; }
+
+        // Pacing. Data goes out at gain percent of cwnd per smoothed round trip time (twice that in slow start, so the
+        // window still grows) instead of the whole window back to back, in bursts of at most maxBurst packets. The
+        // gaps are served with the regular timeout. Gain 0 disables pacing.
+        void setPacingGain(int percent) { shaper().pacingGain = std::max(percent, 0); }
+        int  pacingGain() const { return shaper_ ? shaper_->pacingGain : 0; }
+        void setMaxBurst(int packets) { shaper().maxBurst = std::max(packets, 1); }
+        int  maxBurst() const { return shaper_ ? shaper_->maxBurst : Shaper().maxBurst; }
+
+        // Token bucket rate limiting of user data, of the whole association and per stream. Data over the rate stays
+        // queued and streams with tokens left pass the held ones. A message starts when its buckets have tokens and
+        // then is sent whole, leaving the buckets in debt for the rest of it. Rates are in bytes per second and
+        // bursts are the bucket sizes in bytes, at least the MTU. Rate 0 removes the limit. May be changed at any time.
+        void    setRateLimit(quint64 bytesPerSecond, quint64 burst);
+        quint64 rateLimit() const { return shaper_ ? shaper_->rateLimit.rate : 0; }
+        void    setRateLimit(quint16 streamId, quint64 bytesPerSecond, quint64 burst);
+        quint64 rateLimit(quint16 streamId) const;
+
+        // Packetization Layer Path MTU Discovery (RFC 8899). Once established the association searches upwards from
+        // a safe base size with padded HEARTBEAT probes and never probes beyond the configured maximum. Sizes are
+        // of the sctp packets, so lower layers overhead (DTLS, UDP, IP) has to be subtracted by the caller.
+        void    setMaxPathMtu(quint32 size);
+        quint32 maxPathMtu() const { return maxMtu_; }
+        quint32 pathMtu() const { return mtu_; }
+
+        // Receiver window autotuning. The advertised window starts small and grows to keep up with the rate the
+        // application reads received data per round trip, up to the configured maximum and as long as the sum of
+        // windows of all the associations in the process stays under the global limit.
+        void           setMaxReceiveWindow(quint32 size) { maxReceiveWindow_ = size; }
+        quint32        maxReceiveWindow() const { return maxReceiveWindow_; }
+        quint32        receiveWindow() const { return localWindowCredit_; }
+        static void    setReceiveWindowMemoryLimit(quint64 bytes);
+        static quint64 receiveWindowMemoryUsage();
+
+        // Memory governor. Data buffered by all the associations of the process (send queues, chunks awaiting
+        // acknowledgement and received data not yet read) is kept under one budget. write() refuses messages once
+        // the usage gets near the limit, the rest is kept for the data the peers were allowed to send. From there
+        // each association is held to a fair share: advertised receive windows shrink to what's left of it. The limit
+        // is only exceeded by received chunks filling gaps, bounded by the receive window, as the data after them
+        // can't be delivered otherwise.
+        static void    setBufferedMemoryLimit(quint64 bytes);
+        static quint64 bufferedMemoryLimit();
+        static quint64 totalBufferedMemory();
+        quint64        bufferedMemory() const { return bufferedMemory_; } // of this association
+
+        // Application backpressure with WebRTC semantics. The buffered amount is user data written but not yet sent
+        // to the network, for the whole association or a single stream. bufferedAmountLow notifications are sent when
+        // the amount drops from above the corresponding threshold to or below it.
+        quint64 bufferedAmount() const { return bufferedAmount_; }
+        quint64 bufferedAmount(quint16 streamId) const;
+        void    setBufferedAmountLowThreshold(quint64 bytes) { bufferedLowThreshold_ = bytes; }
+        quint64 bufferedAmountLowThreshold() const { return bufferedLowThreshold_; }
+        void    setBufferedAmountLowThreshold(quint16 streamId, quint64 bytes);
+        quint64 bufferedAmountLowThreshold(quint16 streamId) const;
+
+        // Per-stream flow control, so a flood on one stream doesn't starve the others. Once the stream's messages
+        // waiting in readIncoming() reach the receive limit, further complete messages of the stream are held back
+        // and queued for reading as the application reads the earlier ones, letting other streams through. Above the
+        // send limit of buffered data write() refuses messages of the stream. Per stream values override the
+        // association-wide ones, 0 means no limit.
+        void    setStreamReceiveLimit(quint32 bytes) { streamReceiveLimit_ = bytes; }
+        quint32 streamReceiveLimit() const { return streamReceiveLimit_; }
+        void    setStreamReceiveLimit(quint16 streamId, quint32 bytes);
+        quint32 streamReceiveLimit(quint16 streamId) const;
+        void    setStreamSendLimit(quint32 bytes) { streamSendLimit_ = bytes; }
+        quint32 streamSendLimit() const { return streamSendLimit_; }
+        void    setStreamSendLimit(quint16 streamId, quint32 bytes);
+        quint32 streamSendLimit(quint16 streamId) const;
+        quint64 receivedAmount(quint16 streamId) const; // received and not yet read. see bufferedAmount() for sending
+
+        // Stream reset (RFC 6525), e.g. to close a data channel without touching the rest of the association. The
+        // outgoing streams are reset once the data already written to them is sent, then the peer resets the
+        // incoming ones after receiving all that data. Meanwhile write() refuses messages of the streams. When the
+        // peer confirms onOutgoingStreamsReset() is called, the stream state is freed and sequence numbers start
+        // over. A refused request leaves the streams as they were. Returns false if the peer doesn't support it.
+        bool resetStreams(const QList<quint16> &streamIds);
+
+        // Secret to sign state cookies when answering INIT. Share one between associations of the endpoint, otherwise
+        // the association makes its own.
+        void setCookieSecret(std::shared_ptr<CookieSecret> secret) { cookieSecret_ = std::move(secret); }
+
+        // Retransmission timeout bounds in microseconds (RFC 4960 6.3.1). The actual value is computed from the
+        // measured round trip time.
+        void   setRtoBounds(qint64 min, qint64 max);
+        qint64 rto() const { return rto_; }
+
+        // Keepalive and dead peer detection (RFC 4960 8.1 and 8.3). After usecs microseconds without any traffic nor
+        // data in flight a HEARTBEAT is sent, which keeps the state of middleboxes and lower layers alive and feeds
+        // the rto estimator. Retransmission timeouts and unanswered heartbeats in a row are counted, and beyond
+        // maxRetransmissions of them the association is closed with Error::PeerUnreachable. 0 disables heartbeats.
+        void   setHeartbeatInterval(qint64 usecs);
+        qint64 heartbeatInterval() const { return heartbeatInterval_; }
+        void   setMaxRetransmissions(int count) { maxRetransmissions_ = quint8(qBound(0, count, 255)); }
+        int    maxRetransmissions() const { return maxRetransmissions_; }
+
+        Statistics statistics() const;
+
+        // Approximate heap and object memory of the core in bytes: the object itself, the containers and the payloads
+        // they keep. Walks all the queues, so not for the hot path. An idle core takes under 1 KB. The Association
+        // adapter's QObject, and its QTimer when no Endpoint drives it, come on top and aren't counted.
+        quint64 memoryUsage() const;
+
+        // Idle trimming. Queues keep the capacity they grew to during a burst. After usecs microseconds without any
+        // traffic they are shrunk with trimMemory() and grow again on demand. 0 disables it.
+        void   setIdleTrimDelay(qint64 usecs);
+        qint64 idleTrimDelay() const { return idleTrimDelay_; }
+
+        // gives the spare capacity of the queues and buffers back to the allocator right away, e.g. on memory pressure
+        void trimMemory();
+
+        // serves the timeout requested by AssociationSink::scheduleTimeout()
+        void processTimeouts();
+
+        quint16 sourcePort() const { return sourcePort_; }
+        quint16 destinationPort() const { return destinationPort_; }
+        quint32 verificationTag() const { return myVerificationTag_; } // of incoming packets
+
+    private:
+        friend class Association;
+        friend class Endpoint;
+        friend class Listener;
+
+        enum class Stall : quint8 { None, Window, Congestion };
+        struct InboundStream;
+
+        // onReadyReadOutgoing() is held until the outermost burst ends, so one call covers all the packets
+        class OutgoingBurst {
+        public:
+            explicit OutgoingBurst(AssociationCore *core) : core_(core) { core_->burstDepth_++; }
+            ~OutgoingBurst();
+
+        private:
+            AssociationCore *core_;
+        };
+
+        Packet     initPacket() const;
+        void       populateHeader(Packet &packet);
+        void       sendFirstPriority(Packet &packet);
+        void       notifyOutgoing();
+        void       trySend();
+        QByteArray makeStateCookie();
+        void       setError(Error error);
+        void       initRemote(const InitChunk &chunk);
+        void       restore(const StateCookie &cookie);
+        void       acceptCookieEcho(const QByteArray &data, const StateCookie &cookie);
+        qint64     now() const { return timer_.nsecsElapsed() / 1000; } // microseconds
+        void       updateTimer();
+        void       setEstablished();
+        void       sendSack();
+        template <class Sack> void processSack(const Sack &chunk); // SACK or NR-SACK
+        void       receivedTsn(quint32 tsn);
+        void       tryReassemble(quint32 tsn);
+        void       deliver(InboundStream &stream, Message &&message);
+        void       releaseHeld(InboundStream &stream);
+        void       tuneReceiveWindow(quint64 desired);
+        void       updateRtt(qint64 rtt);
+        void       retransmissionTimeout();
+        void       heartbeatTimeout();
+        bool       countError(); // false if the peer is considered unreachable
+        void       setStall(Stall stall);
+        void       markActive();
+        size_t     nextDataChunk(qint64 ts, qint64 &wait);
+        void       refillPacingCredit(qint64 ts);
+        double     pacingRate() const; // bytes per microsecond
+        bool       chargeMemory(quint64 bytes, bool write);
+        void       releaseMemory(quint64 bytes);
+        quint32    advertisedCredit() const;
+        void       sendStreamReset();
+        void       sendReconfigResponse(quint32 seq, quint32 result);
+        void       resetInboundStreams(const QList<quint16> &streamIds);
+        void       resetOutboundStreams(const QList<quint16> &streamIds);
+        bool       resettingStream(quint16 streamId) const;
+        void       finishDeferredReset();
+        void       incomingResetRequest(const OutgoingSsnResetRequestParameter &request);
+
+        void    startPathMtuDiscovery();
+        void    sendPathMtuProbe(quint32 size);
+        void    continuePathMtuSearch();
+        void    pathMtuTimeout();
+        quint32 nextPathMtuProbeSize() const;
+
+        void incomingChunk(const InitChunk &chunk);
+        void incomingChunk(const InitAckChunk &chunk);
+        void incomingChunk(const CookieEchoChunk &chunk, quint32 verificationTag);
+        void incomingChunk(const CookieAckChunk &chunk);
+        void incomingChunk(const SackChunk &);
+        void incomingChunk(const NrSackChunk &chunk);
+        void incomingChunk(const DataChunk &);
+        void incomingChunk(const HeartbeatChunk &chunk);
+        void incomingChunk(const HeartbeatAckChunk &chunk);
+        void incomingChunk(const ReconfigChunk &chunk);
+
+    private:
+        struct UnackChunk {
+            qint64     timestamp; // when sent, microseconds
+            quint32    tsn;
+            QByteArray data;
+            bool       gapAcked    = false; // acked by a gap block, so not in flight anymore
+            bool       retransmit  = false; // marked for retransmission
+            bool       transmitted = false; // more than once. not suitable for rtt measurement
+            bool       probe       = false; // sent to a closed window, so likely dropped by the peer
+        };
+
+        struct IncomingFragment {
+            quint16    streamId;
+            quint16    ssn;
+            quint8     flags;
+            QByteArray payloadProto;
+            QByteArray data;
+        };
+
+        struct OutboundStream {
+            quint16 nextSsn        = 0;
+            quint32 sendLimit      = 0; // 0 - the association's default
+            quint64 bufferedAmount = 0;
+            quint64 lowThreshold   = 0;
+        };
+
+        struct InboundStream {
+            quint16                                         nextSsn        = 0;
+            quint32                                         receiveLimit   = 0; // 0 - the association's default
+            quint32                                         receivedAmount = 0; // not read yet, incl. fragments
+            quint32                                         queuedAmount   = 0; // delivered, not consumed yet
+            bool                                            reset          = false; // by the peer. freed when read
+            std::map<quint16, Message, SerialLess<quint16>> pending; // ordered messages waiting for a gap
+            RingQueue<Message>                              held; // complete, over the receive limit
+        };
+
+        struct TokenBucket {
+            quint64 rate    = 0; // bytes per second
+            qint64  burst   = 0;
+            qint64  tokens  = 0; // negative while a started message is sent over the limit
+            qint64  updated = 0; // microseconds
+
+            void refill(qint64 ts)
+            {
+                tokens  = std::min(burst, tokens + qint64(double(ts - updated) * double(rate) / 1e6));
+                updated = ts;
+            }
+            qint64 wait() const { return tokens > 0 ? 0 : qint64(double(1 - tokens) * 1e6 / double(rate)) + 1; }
+        };
+
+        // pacing and rate limits. allocated on first use as most associations never need them
+        struct Shaper {
+            int                                   pacingGain    = 0; // percent
+            int                                   maxBurst      = 4; // packets
+            qint64                                pacingCredit  = 0; // bytes to send now. a packet needs a full mtu
+            qint64                                pacingUpdated = 0;
+            TokenBucket                           rateLimit;
+            SortedVectorMap<quint16, TokenBucket> streamRateLimits;
+        };
+
+        // stream reset state. allocated on first use
+        struct StreamReset {
+            std::vector<quint16> pending;   // outgoing streams waiting for their data to be sent
+            std::vector<quint16> requested; // in the outstanding request
+            QByteArray           request;   // the outstanding RE-CONFIG chunk, repeated until answered
+            std::vector<quint16> deferred;  // incoming streams to reset once the data up to deferredTsn is in
+            bool                 deferring   = false;
+            quint32              deferredTsn = 0;
+            quint32              deferredSeq = 0;
+        };
+
+        StreamReset &streamReset()
+        {
+            if (!streamReset_) {
+                streamReset_.reset(new StreamReset);
+            }
+            return *streamReset_;
+        }
+        void releaseStreamReset(); // once nothing is in progress
+
+        Shaper &shaper()
+        {
+            if (!shaper_) {
+                shaper_.reset(new Shaper);
+            }
+            return *shaper_;
+        }
+
+        enum class PmtuPhase : quint8 { Disabled, Base, Searching, SearchComplete, Error };
+
+        State                  state_              = State::Closed;
+        Error                  error_              = Error::None;
+        Stall                  stall_              = Stall::None;
+        quint8                 ackState            = 0;
+        quint8                 errorCount_         = 0;  // retransmission and heartbeat timeouts in a row
+        quint8                 maxRetransmissions_ = 10; // RFC 4960 Association.Max.Retrans
+        AssociationSink *      sink_;
+        QElapsedTimer          timer_;
+        qint64                 flushDeadline_ = -1; // when Nagle-held data has to be sent
+        RingQueue<Packet>      outgoingPackets_;
+        RingQueue<UnackChunk>  dataSendQueue_;
+        RingQueue<UnackChunk>  controlSendQueue_;
+        std::map<quint32, UnackChunk, SerialLess<quint32>>       unacknowledgedChunks; // outgoing chunks tsn => chunk
+        SortedVectorMap<quint16, OutboundStream>                 outboundStreams_; // created on first use
+        std::map<quint32, IncomingFragment, SerialLess<quint32>> fragments_;    // not yet reassembled. tsn => fragment
+        std::set<quint32, SerialLess<quint32>>                   receivedTsns_; // received above lastRcvdTsn_
+        std::vector<quint32>                                     duplicateTsns_; // to be reported with next sack
+        SortedVectorMap<quint16, InboundStream>                  inboundStreams_; // created on first use
+        RingQueue<Message>                                       incomingMessages_;
+        std::unique_ptr<Shaper>                                  shaper_;
+        std::unique_ptr<StreamReset>                             streamReset_;
+        std::shared_ptr<CookieSecret>                            cookieSecret_;
+        const StateCookie *verifiedCookie_ = nullptr; // already checked by the listener
+
+        quint32 myVerificationTag_    = 0; // in incoming packets. local-generated.
+        quint32 peerVerificationTag_  = 0; // with each outgoing sctp packet. to be checked on remote side
+        quint32 nextTsn_              = 0;
+        quint32 lastRcvdTsn_          = 0;
+        quint16 sourcePort_           = 0;
+        quint16 destinationPort_      = 0;
+        quint16 inboundStreamsCount_  = 65535;
+        quint16 outboundStreamsCount_ = 65535;
+        quint32 localWindowCredit_    = InitialReceiveWindow; // autotuned. see tuneReceiveWindow()
+        quint32 localUsedCredit_      = 0;         // total received bytes not yet read by the application
+        quint32 lastAdvertisedCredit_ = 0;
+        quint32 maxReceiveWindow_     = 16 * 1024 * 1024;
+        quint32 remoteWindowCredit_   = 512 * 1024;
+        quint32 remoteUsedCredit_     = 0;    // in flight. sent and not yet acknowledged nor marked for retransmission
+        quint32 cumulativeTsnAck_     = 0;    // last cumulative ack from the peer
+        quint32 retransmitCount_      = 0;    // chunks marked for retransmission
+        quint32 mtu_                  = 1200; // confirmed path mtu. see RFC 8899 BASE_PLPMTU
+        quint32 maxMtu_               = 1400; // for loopback may be way more
+        quint32 cwnd_                 = 4380; // Congestion control window
+        quint32 ssthresh_             = 0;    // Slow-start threshold
+        quint32 partialBytesAcked     = 0;
+        quint32 dataQueuedBytes_      = 0;    // total size of chunks in dataSendQueue_
+        quint32 streamReceiveLimit_   = 0;
+        quint32 streamSendLimit_      = 0;
+        quint64 bufferedAmount_       = 0;    // user data in dataSendQueue_
+        quint64 bufferedLowThreshold_ = 0;
+        quint64 bufferedMemory_       = 0; // charged to the process-wide budget
+        qint64  holdDeadline_         = -1; // when data held by pacing or rate limits may be sent again
+        int     nagleDelay_           = 0;
+        qint32  sendingStream_        = -1; // its message is partially sent and has to be continued first
+        int     batchDepth_           = 0;
+        int     burstDepth_           = 0;
+        bool    outgoingNotify_       = false; // held by OutgoingBurst
+        bool    ingesting_            = false; // inside writeIncoming() of a batch
+        bool    sackDeferred_         = false;
+        bool    sendDeferred_         = false;
+        bool    incomingNotify_       = false;
+        bool    rttMeasuring_         = false;
+        bool    peerNrSack_           = false; // the peer accepts NR-SACK instead of SACK
+        bool    peerReconfig_         = false; // the peer accepts stream reset requests
+        quint32 rttTsn_               = 0;  // tsn used for the current rtt measurement
+        quint32 reconfigSeq_          = 0;  // of our next reconfiguration request. starts at the initial tsn
+        quint32 peerReconfigSeq_      = 0;  // expected in the next request of the peer
+        quint32 peerReconfigResult_   = 0;  // to the last request of the peer, repeated on retransmissions
+        qint64  reconfigDeadline_     = -1; // when the outstanding request is repeated
+        qint64  srtt_                 = 0;  // smoothed round trip time, microseconds. 0 if not measured yet
+        qint64  rttvar_               = 0;
+        qint64  rto_                  = 3000000;
+        qint64  rtoMin_               = 1000000;
+        qint64  rtoMax_               = 60000000;
+        qint64  heartbeatInterval_    = 30000000; // RFC 4960 HB.interval
+        qint64  heartbeatDeadline_    = -1;       // idleness check or the outstanding heartbeat timeout
+        quint64 heartbeatNonce_       = 0;        // of the outstanding heartbeat, 0 if none
+        qint64  t3Deadline_           = -1; // retransmission timer
+        qint64  stallStarted_         = 0;
+        qint64  idleTrimDelay_        = 5000000; // microseconds
+        qint64  lastActive_           = 0;
+        qint64  trimDeadline_         = -1; // checks for idleness, may be behind lastActive_ + idleTrimDelay_
+
+        Statistics stats_;
+        qint64  handshakeStarted_     = 0;
+        qint64  sackDeadline_         = -1; // delayed ack
+        qint64  drainStarted_         = 0;  // start of the current receive autotuning interval
+        quint32 drainedBytes_         = 0;  // bytes read by the application during the interval
+
+        PmtuPhase pmtuPhase_      = PmtuPhase::Disabled;
+        quint8    pmtuProbeCount_ = 0;  // probes sent of the current size
+        quint32   pmtuProbeSize_  = 0;  // size of the outstanding probe, 0 if none
+        quint32   pmtuFailedSize_ = 0;  // smallest size known to not pass
+        quint64   pmtuProbeNonce_ = 0;
+        qint64    pmtuDeadline_   = -1; // probe timeout or time to raise the path mtu again
+    };
+
+} // namespace Sctp
+} // namespace SctpDc
@@ -25,6 +25,27 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include "sctp_chunk.h"
 
 namespace SctpDc { namespace Sctp {
+    namespace {
+        char *writeGaps(char *ptr, const QList<SackChunk::Gap> &gaps)
+        {
+            for (const auto &gap : gaps) {
+                qToBigEndian(gap.begin, ptr);
+                qToBigEndian(gap.end, ptr + 2);
+                ptr += 4;
+            }
+            return ptr;
+        }
+
+        QList<SackChunk::Gap> readGaps(const char *ptr, int count)
+        {
+            QList<SackChunk::Gap> ret;
+            for (int i = 0; i < count; i++) {
+                ret.append({ qFromBigEndian<quint16>(ptr), qFromBigEndian<quint16>(ptr + 2) });
+                ptr += 4;
+            }
+            return ret;
+        }
+    }
 
     void SackChunk::setData(const QList<SackChunk::Gap> &gaps, const QList<quint32> &dups)
     {
@@ -69,4 +90,24 @@ namespace SctpDc { namespace Sctp {
         }
         return ret;
     }
+
+    void NrSackChunk::setData(const QList<Gap> &gaps, const QList<Gap> &nrGaps, const QList<quint32> &dups)
+    {
+        ensureCapacity(offset + MinHeaderSize + (gaps.size() + nrGaps.size() + dups.size()) * 4);
+        char *ptr = writeGaps(writeGaps(data.data() + offset + MinHeaderSize, gaps), nrGaps);
+        for (const auto &dup : dups) {
+            qToBigEndian(dup, ptr);
+            ptr += 4;
+        }
+    }
+
+    QList<NrSackChunk::Gap> NrSackChunk::gaps() const
+    {
+        return readGaps(data.constData() + offset + MinHeaderSize, gapAckBlocksCount());
+    }
+
+    QList<NrSackChunk::Gap> NrSackChunk::nrGaps() const
+    {
+        return readGaps(data.constData() + offset + MinHeaderSize + gapAckBlocksCount() * 4, nrGapAckBlocksCount());
+    }
 }}
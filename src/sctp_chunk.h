@@ -32,18 +32,22 @@ namespace SctpDc { namespace Sctp {
         constexpr static quint8  Type          = 0;
         constexpr static quint16 MinHeaderSize = 16;
 
+        constexpr static quint8 UnorderedFlag = 0x4;
+        constexpr static quint8 BeginningFlag = 0x2;
+        constexpr static quint8 EndingFlag    = 0x1;
+
         using ChunkWithPayload::ChunkWithPayload;
 
         inline bool isValid() const { return Chunk::isValid(16); }
 
-        inline bool isUnordered() const { return flags() & 0x4; }
-        inline bool isBeginning() const { return flags() & 0x2; }
-        inline bool isEnding() const { return flags() & 0x1; }
+        inline bool isUnordered() const { return flags() & UnorderedFlag; }
+        inline bool isBeginning() const { return flags() & BeginningFlag; }
+        inline bool isEnding() const { return flags() & EndingFlag; }
         inline bool isFragmented() const { return (flags() & 0x3) != 0x3; }
 
-        inline void setUnordered(bool value) { setFlag(0x4, value); }
-        inline void setBeginning(bool value) { setFlag(0x2, value); }
-        inline void setEnding(bool value) { setFlag(0x1, value); }
+        inline void setUnordered(bool value) { setFlag(UnorderedFlag, value); }
+        inline void setBeginning(bool value) { setFlag(BeginningFlag, value); }
+        inline void setEnding(bool value) { setFlag(EndingFlag, value); }
 
         inline quint32 tsn() const { return qFromBigEndian<quint32>(data.constData() + offset + 4); }
         inline void    setTsn(quint32 tsn) { qToBigEndian(tsn, data.data() + offset + 4); }
@@ -68,11 +72,11 @@ namespace SctpDc { namespace Sctp {
     class InitChunk : public ChunkWithParameters<InitChunk> {
     public:
         constexpr static quint8 Type          = 1;
-        constexpr static int    MinHeaderSize = 16;
+        constexpr static int    MinHeaderSize = 20;
 
         using ChunkWithParameters::ChunkWithParameters;
 
-        inline bool isValid() const { return Chunk::isValid(16); }
+        inline bool isValid() const { return Chunk::isValid(20); }
 
         inline quint32 initiateTag() const { return qFromBigEndian<quint32>(data.constData() + offset + 4); }
         inline void    setInitiateTag(quint32 tag) { qToBigEndian(tag, data.data() + offset + 4); }
@@ -138,4 +142,69 @@ namespace SctpDc { namespace Sctp {
         QList<SackChunk::Gap> gaps() const;
         QList<quint32>        dups() const;
     };
+
+    // draft-natarajan-tsvwg-sctp-nrsack. SACK with additional gap blocks of data the receiver won't renege on, so the
+    // sender can free it before the cumulative ack passes it
+    class NrSackChunk : public Chunk {
+    public:
+        constexpr static quint8 Type          = 0x10;
+        constexpr static int    MinHeaderSize = 20;
+
+        using Gap = SackChunk::Gap;
+        using Chunk::Chunk;
+
+        inline quint32 cumulativeTSNAck() const { return qFromBigEndian<quint32>(data.constData() + offset + 4); }
+        inline void    setCumulativeTSNAck(quint32 tag) { qToBigEndian(tag, data.data() + offset + 4); }
+
+        inline quint32 receiverWindowCredit() const { return qFromBigEndian<quint32>(data.constData() + offset + 8); }
+        inline void    setReceiverWindowCredit(quint32 tag) { qToBigEndian(tag, data.data() + offset + 8); }
+
+        inline quint16 gapAckBlocksCount() const { return qFromBigEndian<quint16>(data.constData() + offset + 12); }
+        inline void    setGapAckBlocksCount(quint16 count) { qToBigEndian(count, data.data() + offset + 12); }
+
+        inline quint16 nrGapAckBlocksCount() const { return qFromBigEndian<quint16>(data.constData() + offset + 14); }
+        inline void    setNrGapAckBlocksCount(quint16 count) { qToBigEndian(count, data.data() + offset + 14); }
+
+        inline quint16 duplicateTSNCount() const { return qFromBigEndian<quint16>(data.constData() + offset + 16); }
+        inline void    setDuplicateTSNCount(quint16 count) { qToBigEndian(count, data.data() + offset + 16); }
+
+        void       setData(const QList<Gap> &gaps, const QList<Gap> &nrGaps, const QList<quint32> &dups);
+        QList<Gap> gaps() const;
+        QList<Gap> nrGaps() const;
+    };
+
+    class HeartbeatChunk : public ChunkWithParameters<HeartbeatChunk> {
+    public:
+        constexpr static quint8 Type          = 4;
+        constexpr static int    MinHeaderSize = 4;
+        using ChunkWithParameters::ChunkWithParameters;
+    };
+
+    class HeartbeatAckChunk : public HeartbeatChunk {
+    public:
+        constexpr static quint8 Type = 5;
+        using HeartbeatChunk::HeartbeatChunk;
+    };
+
+    // RFC 6525. Stream reconfiguration requests and responses, carried as parameters
+    class ReconfigChunk : public ChunkWithParameters<ReconfigChunk> {
+    public:
+        constexpr static quint8 Type          = 130;
+        constexpr static int    MinHeaderSize = 4;
+        using ChunkWithParameters::ChunkWithParameters;
+    };
+
+    // chunk types of the extensions we support. see SupportedExtensionsParameter
+    inline QByteArray supportedExtensions()
+    {
+        return QByteArray(1, char(NrSackChunk::Type)).append(char(ReconfigChunk::Type));
+    }
+
+    // RFC 4820. Used to pad path mtu probes (RFC 8899)
+    class PadChunk : public ChunkWithPayload<PadChunk> {
+    public:
+        constexpr static quint8 Type          = 0x84;
+        constexpr static int    MinHeaderSize = 4;
+        using ChunkWithPayload::ChunkWithPayload;
+    };
 }}
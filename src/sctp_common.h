@@ -29,8 +29,33 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <QtEndian>
 
 #include <type_traits>
+#include <vector>
 
 namespace SctpDc { namespace Sctp {
+    // serial number arithmetic (RFC 1982) for TSNs and stream sequence numbers
+    template <class T> inline bool serialLess(T a, T b)
+    {
+        return typename std::make_signed<T>::type(T(a - b)) < 0;
+    }
+
+    template <class T> struct SerialLess {
+        bool operator()(T a, T b) const { return serialLess(a, b); }
+    };
+
+    // Adjusts a random non-zero verification tag so tag % count == index. Lets a sharded engine route packets of an
+    // association to its shard by the tag alone.
+    inline quint32 shardVerificationTag(quint32 tag, quint32 index, quint32 count)
+    {
+        if (count < 2) {
+            return tag ? tag : 1;
+        }
+        auto base = tag - tag % count;
+        if (base > ~quint32(0) - index) {
+            base -= count;
+        }
+        return base + index ? base + index : count;
+    }
+
     template <class Item, class Data> class Iterator {
     public:
         Item item;
@@ -288,5 +313,22 @@ namespace SctpDc { namespace Sctp {
         QByteArray data_;
     };
 
+    // Packets laid out back to back in one buffer, e.g. to be passed to sendmmsg() without copying each one again
+    struct PacketBatch {
+        struct Segment {
+            int offset;
+            int size;
+        };
+
+        QByteArray           buffer;
+        std::vector<Segment> segments;
+
+        void clear()
+        {
+            buffer.clear();
+            segments.clear();
+        }
+    };
+
 } // namespace Sctp
 } // namespace SctpDc
@@ -0,0 +1,167 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace SctpDc { namespace Sctp {
+
+    // FIFO over a power of two ring buffer. Unlike std::deque it allocates nothing until the first element is pushed
+    // and can give all its memory back with shrink().
+    template <class T> class RingQueue {
+    public:
+        bool   empty() const { return size_ == 0; }
+        size_t size() const { return size_; }
+        size_t capacity() const { return items_.size(); }
+
+        T &      front() { return items_[head_]; }
+        const T &front() const { return items_[head_]; }
+        T &      operator[](size_t i) { return items_[(head_ + i) & (items_.size() - 1)]; }
+        const T &operator[](size_t i) const { return items_[(head_ + i) & (items_.size() - 1)]; }
+
+        void push_back(T value)
+        {
+            if (size_ == items_.size())
+                reallocate(std::max(size_t(4), items_.size() * 2));
+            items_[(head_ + size_) & (items_.size() - 1)] = std::move(value);
+            size_++;
+        }
+
+        void push_front(T value)
+        {
+            if (size_ == items_.size())
+                reallocate(std::max(size_t(4), items_.size() * 2));
+            head_         = (head_ - 1) & quint32(items_.size() - 1);
+            items_[head_] = std::move(value);
+            size_++;
+        }
+
+        void pop_front()
+        {
+            items_[head_] = T(); // release what the element holds right away
+            head_         = (head_ + 1) & quint32(items_.size() - 1);
+            size_--;
+        }
+
+        // removes the element at i by shifting the shorter side, so near the ends it's as cheap as a pop
+        void erase(size_t i)
+        {
+            if (i < size_ / 2) {
+                for (; i > 0; i--) {
+                    (*this)[i] = std::move((*this)[i - 1]);
+                }
+                pop_front();
+                return;
+            }
+            for (; i + 1 < size_; i++) {
+                (*this)[i] = std::move((*this)[i + 1]);
+            }
+            (*this)[i] = T();
+            size_--;
+        }
+
+        // frees the memory if empty or shrinks the buffer to the smallest power of two that fits
+        void shrink()
+        {
+            size_t capacity = size_ ? 4 : 0;
+            while (capacity < size_)
+                capacity *= 2;
+            if (capacity < items_.size())
+                reallocate(capacity);
+        }
+
+    private:
+        void reallocate(size_t capacity)
+        {
+            std::vector<T> items(capacity);
+            for (size_t i = 0; i < size_; i++) {
+                items[i] = std::move((*this)[i]);
+            }
+            items_.swap(items);
+            head_ = 0;
+        }
+
+        std::vector<T> items_;
+        quint32        head_ = 0;
+        quint32        size_ = 0;
+    };
+
+    // Map over a vector sorted by key. Allocates nothing while empty and a lookup is a binary search within one
+    // contiguous block, which beats a tree for the few dozens of entries of typical per-stream state.
+    template <class K, class V> class SortedVectorMap {
+    public:
+        using value_type = std::pair<K, V>;
+
+        bool   empty() const { return items_.empty(); }
+        size_t size() const { return items_.size(); }
+        size_t capacity() const { return items_.capacity(); }
+
+        typename std::vector<value_type>::iterator       begin() { return items_.begin(); }
+        typename std::vector<value_type>::iterator       end() { return items_.end(); }
+        typename std::vector<value_type>::const_iterator begin() const { return items_.begin(); }
+        typename std::vector<value_type>::const_iterator end() const { return items_.end(); }
+
+        V *find(K key)
+        {
+            auto it = lowerBound(key);
+            return it != items_.end() && it->first == key ? &it->second : nullptr;
+        }
+        const V *find(K key) const { return const_cast<SortedVectorMap *>(this)->find(key); }
+
+        // inserts a default value if missing. references are invalidated by following insertions
+        V &operator[](K key)
+        {
+            auto it = lowerBound(key);
+            if (it == items_.end() || it->first != key)
+                it = items_.insert(it, value_type(key, V()));
+            return it->second;
+        }
+
+        bool erase(K key)
+        {
+            auto it = lowerBound(key);
+            if (it == items_.end() || it->first != key)
+                return false;
+            items_.erase(it);
+            return true;
+        }
+
+        void shrink() { items_.shrink_to_fit(); }
+
+    private:
+        typename std::vector<value_type>::iterator lowerBound(K key)
+        {
+            return std::lower_bound(items_.begin(), items_.end(), key,
+                                    [](const value_type &item, K k) { return item.first < k; });
+        }
+
+        std::vector<value_type> items_;
+    };
+
+}}
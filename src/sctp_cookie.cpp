@@ -0,0 +1,145 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_cookie.h"
+#include "sctp_siphash.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#endif
+#include <QtEndian>
+
+namespace SctpDc { namespace Sctp {
+    namespace {
+        constexpr int MacSize       = 16;
+        constexpr int TimestampPos  = 28;
+        constexpr int LifetimePos   = 36;
+        constexpr int GenerationPos = 40;
+        constexpr int FlagsPos      = 41;
+        constexpr int MacPos        = CookieSecret::CookieSize - MacSize;
+
+        quint64 random64()
+        {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+            return QRandomGenerator::global()->generate64();
+#else
+            return (quint64(quint32(qrand())) << 32) | quint32(qrand());
+#endif
+        }
+
+        // doesn't leak with timing how many bytes matched
+        bool constantTimeEquals(const char *a, const char *b, int size)
+        {
+            quint8 diff = 0;
+            for (int i = 0; i < size; i++) {
+                diff |= quint8(a[i] ^ b[i]);
+            }
+            return diff == 0;
+        }
+    }
+
+    CookieSecret::CookieSecret(qint64 rotationInterval) : rotationInterval_(rotationInterval)
+    {
+        for (auto &key : keys_) {
+            key[0] = random64();
+            key[1] = random64();
+        }
+        clock_.start();
+    }
+
+    void CookieSecret::rotate()
+    {
+        generation_++;
+        keys_[generation_ & 1][0] = random64();
+        keys_[generation_ & 1][1] = random64();
+        rotated_                  = now();
+    }
+
+    void CookieSecret::rotateIfNeeded()
+    {
+        if (now() - rotated_ >= rotationInterval_ * 1000) {
+            rotate();
+        }
+    }
+
+    QByteArray CookieSecret::makeCookie(const StateCookie &state)
+    {
+        rotateIfNeeded();
+        QByteArray cookie(CookieSize, Qt::Uninitialized);
+        char *     d = cookie.data();
+        qToBigEndian(state.myVerificationTag, d);
+        qToBigEndian(state.peerVerificationTag, d + 4);
+        qToBigEndian(state.myInitialTsn, d + 8);
+        qToBigEndian(state.peerInitialTsn, d + 12);
+        qToBigEndian(state.peerWindowCredit, d + 16);
+        qToBigEndian(state.inboundStreamsCount, d + 20);
+        qToBigEndian(state.outboundStreamsCount, d + 22);
+        qToBigEndian(state.sourcePort, d + 24);
+        qToBigEndian(state.destinationPort, d + 26);
+        qToBigEndian(quint64(now()), d + TimestampPos);
+        qToBigEndian(lifetime_, d + LifetimePos);
+        d[GenerationPos] = char(generation_);
+        d[FlagsPos]      = char((state.peerNrSack ? 1 : 0) | (state.peerReconfig ? 2 : 0));
+        d[FlagsPos + 1] = d[FlagsPos + 2] = 0;
+        sipHash128(keys_[generation_ & 1], d, MacPos, d + MacPos);
+        return cookie;
+    }
+
+    bool CookieSecret::openCookie(const QByteArray &cookie, StateCookie &state)
+    {
+        if (cookie.size() != CookieSize) {
+            return false;
+        }
+        rotateIfNeeded();
+        const char *d          = cookie.constData();
+        quint8      generation = quint8(d[GenerationPos]);
+        if (generation != generation_ && generation != quint8(generation_ - 1)) {
+            return false; // signed with an outdated secret
+        }
+        char mac[MacSize];
+        sipHash128(keys_[generation & 1], d, MacPos, mac);
+        if (!constantTimeEquals(mac, d + MacPos, MacSize)) {
+            return false;
+        }
+        auto age = now() - qint64(qFromBigEndian<quint64>(d + TimestampPos));
+        if (age < 0 || age > qint64(qFromBigEndian<quint32>(d + LifetimePos)) * 1000) {
+            return false; // stale
+        }
+
+        state.myVerificationTag    = qFromBigEndian<quint32>(d);
+        state.peerVerificationTag  = qFromBigEndian<quint32>(d + 4);
+        state.myInitialTsn         = qFromBigEndian<quint32>(d + 8);
+        state.peerInitialTsn       = qFromBigEndian<quint32>(d + 12);
+        state.peerWindowCredit     = qFromBigEndian<quint32>(d + 16);
+        state.inboundStreamsCount  = qFromBigEndian<quint16>(d + 20);
+        state.outboundStreamsCount = qFromBigEndian<quint16>(d + 22);
+        state.sourcePort           = qFromBigEndian<quint16>(d + 24);
+        state.destinationPort      = qFromBigEndian<quint16>(d + 26);
+        state.peerNrSack           = d[FlagsPos] & 1;
+        state.peerReconfig         = d[FlagsPos] & 2;
+        state.age                  = age;
+        return true;
+    }
+
+}}
@@ -0,0 +1,82 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include <QByteArray>
+#include <QElapsedTimer>
+
+namespace SctpDc { namespace Sctp {
+
+    // TCB snapshot carried by the state cookie (RFC 4960 5.1.3). Enough to build the association on COOKIE-ECHO.
+    struct StateCookie {
+        quint32 myVerificationTag    = 0;
+        quint32 peerVerificationTag  = 0;
+        quint32 myInitialTsn         = 0;
+        quint32 peerInitialTsn       = 0;
+        quint32 peerWindowCredit     = 0;
+        quint16 inboundStreamsCount  = 0;
+        quint16 outboundStreamsCount = 0;
+        quint16 sourcePort           = 0;
+        quint16 destinationPort      = 0;
+        bool    peerNrSack           = false; // the peer accepts NR-SACK
+        bool    peerReconfig         = false; // the peer accepts RE-CONFIG
+        qint64  age                  = 0; // microseconds since the cookie was made. filled by openCookie()
+    };
+
+    // Endpoint-wide secret to sign state cookies. The secret is regenerated every rotation interval and cookies signed
+    // with the previous one are still accepted. Besides, each cookie carries its creation time and lifetime.
+    //
+    // The cookie has fixed layout of packed big-endian fields followed by the generation of the secret and
+    // SipHash-2-4-128 MAC of all that.
+    class CookieSecret {
+    public:
+        constexpr static qint64  DefaultRotationInterval = 60000; // milliseconds
+        constexpr static quint32 DefaultCookieLifetime   = 60000; // milliseconds. RFC 4960 Valid.Cookie.Life
+        constexpr static int     CookieSize              = 60;
+
+        explicit CookieSecret(qint64 rotationInterval = DefaultRotationInterval);
+
+        void    setCookieLifetime(quint32 msecs) { lifetime_ = msecs; }
+        quint32 cookieLifetime() const { return lifetime_; }
+
+        QByteArray makeCookie(const StateCookie &state);
+        // returns false if the cookie is broken, forged, stale or signed with an outdated secret
+        bool openCookie(const QByteArray &cookie, StateCookie &state);
+
+        void rotate();
+
+    private:
+        void   rotateIfNeeded();
+        qint64 now() const { return clock_.nsecsElapsed() / 1000; } // microseconds
+
+        quint64       keys_[2][2]; // indexed by generation parity
+        quint8        generation_ = 0;
+        quint32       lifetime_   = DefaultCookieLifetime;
+        qint64        rotationInterval_;
+        qint64        rotated_ = 0; // when, microseconds
+        QElapsedTimer clock_;
+    };
+
+}}
@@ -0,0 +1,250 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_endpoint.h"
+#include "sctp_association.h"
+#include "sctp_cookie.h"
+#include "sctp_listener.h"
+
+#include <QTimer>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#endif
+
+#include <algorithm>
+#include <functional>
+
+namespace SctpDc { namespace Sctp {
+
+    Endpoint::Endpoint(QObject *parent) :
+        QObject(parent), secret_(std::make_shared<CookieSecret>()), timer_(new QTimer(this))
+    {
+        clock_.start();
+        timer_->setSingleShot(true);
+        timer_->setTimerType(Qt::PreciseTimer);
+        connect(timer_, &QTimer::timeout, this, &Endpoint::processTimeouts);
+    }
+
+    Endpoint::~Endpoint() = default;
+
+    quint64 Endpoint::makeKey(const Association *association)
+    {
+        return makeKey(association->sourcePort(), association->destinationPort(), association->verificationTag());
+    }
+
+    void Endpoint::setVerificationTagShard(quint32 index, quint32 count)
+    {
+        shardIndex_ = index;
+        shardCount_ = count;
+        for (const auto &l : listeners_) {
+            l.second->setVerificationTagShard(index, count);
+        }
+    }
+
+    void Endpoint::listen(quint16 port)
+    {
+        if (listeners_.count(port)) {
+            return;
+        }
+        auto listener = new Listener(port, this);
+        listener->setCookieSecret(secret_);
+        listener->setVerificationTagShard(shardIndex_, shardCount_);
+        connect(listener, &Listener::readyReadOutgoing, this, &Endpoint::readyReadOutgoing);
+        connect(listener, &Listener::newAssociation, this, [this, listener]() { takePendingAssociations(listener); });
+        listeners_.emplace(port, listener);
+    }
+
+    Association *Endpoint::associate(quint16 localPort, quint16 remotePort)
+    {
+        auto association = new Association(localPort, remotePort, this);
+        association->setCookieSecret(secret_);
+        // nothing is sent yet, so the tag can be just replaced
+        auto tag = association->myVerificationTag_;
+        for (;;) {
+            association->myVerificationTag_ = shardVerificationTag(tag, shardIndex_, shardCount_);
+            if (adopt(association)) {
+                break;
+            }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+            tag = QRandomGenerator::global()->generate();
+#else
+            tag = quint32(qrand());
+#endif
+        }
+        association->associate();
+        return association;
+    }
+
+    void Endpoint::removeAssociation(Association *association)
+    {
+        if (association->endpoint_ != this || !associations_.erase(makeKey(association))) {
+            return;
+        }
+        if (association->endpointReady_) {
+            ready_.erase(std::find(ready_.begin(), ready_.end(), association));
+        }
+        association->endpoint_ = nullptr;
+        association->deleteLater();
+    }
+
+    void Endpoint::trimMemory()
+    {
+        associations_.forEach([](quint64, Association *association) { association->trimMemory(); });
+        ready_.shrink_to_fit();
+        timers_.shrink_to_fit();
+    }
+
+    bool Endpoint::adopt(Association *association)
+    {
+        if (!associations_.insert(makeKey(association), association)) {
+            return false;
+        }
+        association->setParent(this);
+        association->endpoint_ = this;
+        connect(association, &Association::errorOccured, this, [this, association]() {
+            if (association->error() == Association::Error::PeerUnreachable) {
+                removeAssociation(association);
+            }
+        });
+        delete association->timeoutTimer_;
+        association->timeoutTimer_ = nullptr;
+        association->updateTimer();
+        setReady(association); // in case it has something from before
+        return true;
+    }
+
+    void Endpoint::setReady(Association *association)
+    {
+        if (association->endpointReady_) {
+            return;
+        }
+        association->endpointReady_ = true;
+        ready_.push_back(association);
+        emit readyReadOutgoing();
+    }
+
+    void Endpoint::takePendingAssociations(Listener *listener)
+    {
+        while (auto association = listener->nextPendingAssociation()) {
+            if (!adopt(association)) {
+                delete association; // the tag is taken by another association with the same peer port
+                continue;
+            }
+            emit newAssociation(association);
+        }
+    }
+
+    QByteArray Endpoint::readOutgoing()
+    {
+        for (const auto &l : listeners_) {
+            auto data = l.second->readOutgoing();
+            if (!data.isEmpty()) {
+                return data;
+            }
+        }
+        while (!ready_.empty()) {
+            auto association = ready_.front();
+            auto data        = association->readOutgoing();
+            if (!data.isEmpty()) {
+                return data;
+            }
+            association->endpointReady_ = false;
+            ready_.pop_front();
+        }
+        return QByteArray();
+    }
+
+    void Endpoint::writeIncoming(const QByteArray &data)
+    {
+        const Packet pkt(data);
+        if (pkt.size() < Packet::HeaderSize || !pkt.sourcePort() || !pkt.destinationPort()) {
+            return; // port 0 is never valid (RFC 4960 3.1)
+        }
+        // the rest is validated by the receiver
+        auto association
+            = associations_.find(makeKey(pkt.destinationPort(), pkt.sourcePort(), pkt.verificationTag()));
+        if (association) {
+            (*association)->writeIncoming(data);
+            return;
+        }
+        auto it = listeners_.find(pkt.destinationPort());
+        if (it != listeners_.end()) {
+            it->second->writeIncoming(data);
+        }
+    }
+
+    void Endpoint::scheduleTimeout(Association *association, qint64 delay)
+    {
+        if (delay < 0) {
+            association->endpointDeadline_ = -1; // makes the heap entry stale
+            return;
+        }
+        auto deadline = now() + delay;
+        if (association->endpointDeadline_ >= 0 && association->endpointDeadline_ <= deadline) {
+            // the earlier entry wakes it up and then it reschedules. restarted timers don't flood the heap this way
+            return;
+        }
+        association->endpointDeadline_ = deadline;
+        timers_.push_back({ deadline, makeKey(association) });
+        std::push_heap(timers_.begin(), timers_.end(), std::greater<TimerEntry>());
+        armTimer();
+    }
+
+    void Endpoint::armTimer()
+    {
+        if (timers_.empty()) {
+            timer_->stop();
+            armedDeadline_ = -1;
+            return;
+        }
+        auto deadline = timers_.front().deadline;
+        if (armedDeadline_ >= 0 && armedDeadline_ <= deadline) {
+            return;
+        }
+        armedDeadline_ = deadline;
+        // rounded up, so the timer doesn't fire before the deadline and spin re-arming itself
+        timer_->start(int((std::max(qint64(0), deadline - now()) + 999) / 1000));
+    }
+
+    void Endpoint::processTimeouts()
+    {
+        armedDeadline_ = -1;
+        auto ts        = now();
+        while (!timers_.empty() && timers_.front().deadline <= ts) {
+            auto entry = timers_.front();
+            std::pop_heap(timers_.begin(), timers_.end(), std::greater<TimerEntry>());
+            timers_.pop_back();
+
+            auto association = associations_.find(entry.key);
+            if (!association || (*association)->endpointDeadline_ != entry.deadline) {
+                continue; // removed or rescheduled
+            }
+            (*association)->endpointDeadline_ = -1;
+            (*association)->processTimeouts();
+        }
+        armTimer();
+    }
+
+}}
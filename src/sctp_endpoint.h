@@ -0,0 +1,124 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include "sctp_flat_hash.h"
+
+#include <QElapsedTimer>
+#include <QObject>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+class QTimer;
+
+namespace SctpDc { namespace Sctp {
+
+    class Association;
+    class CookieSecret;
+    class Listener;
+
+    // Many associations behind one packet interface, e.g. for a server with tens of thousands of peers over UDP
+    // encapsulation. Incoming packets are routed with a single flat hash lookup by (ports, verification tag), unknown
+    // ones go to the listener of the port. The endpoint owns the associations, the cookie secret shared by all of
+    // them and a single timer serving all their timeouts.
+    //
+    // The associations are still Association QObjects, as they are handed to the application with their signals.
+    // The endpoint only skips the per-association QTimer and signal connection. A bare AssociationCore saves the
+    // QObject as well, but its owner has to route the packets and serve the timeouts on its own.
+    class Endpoint : public QObject {
+        Q_OBJECT
+    public:
+        explicit Endpoint(QObject *parent = nullptr);
+        ~Endpoint() override;
+
+        std::shared_ptr<CookieSecret> cookieSecret() const { return secret_; }
+
+        // local verification tags are chosen so tag % count == index. see Engine
+        void setVerificationTagShard(quint32 index, quint32 count);
+
+        // accept incoming associations on the local port. newAssociation() is emitted for each established one
+        void listen(quint16 port);
+
+        // start a new outgoing association. it's owned by the endpoint
+        Association *associate(quint16 localPort, quint16 remotePort);
+
+        // forget the association and delete it later, so it's safe to call from its signals. associations that lost
+        // their peer (see AssociationCore::setHeartbeatInterval()) are removed this way right after errorOccured()
+        void removeAssociation(Association *association);
+        int  associationsCount() const { return associations_.size(); }
+
+        // AssociationCore::trimMemory() of all the associations, plus the endpoint's own spare capacity
+        void trimMemory();
+
+        // packets of all the associations and listeners, in no particular order. read until an empty array is
+        // returned. the destination is in the packet header (ports and verification tag)
+        QByteArray readOutgoing();
+
+        // data - an sctp packet right from network
+        void writeIncoming(const QByteArray &data);
+
+    signals:
+        void readyReadOutgoing();
+        void newAssociation(Association *association);
+
+    private:
+        friend class Association;
+
+        struct TimerEntry {
+            qint64  deadline;
+            quint64 key;
+            bool    operator>(const TimerEntry &other) const { return deadline > other.deadline; }
+        };
+
+        static quint64 makeKey(quint16 localPort, quint16 remotePort, quint32 verificationTag)
+        {
+            return (quint64(localPort) << 48) | (quint64(remotePort) << 32) | verificationTag;
+        }
+        static quint64 makeKey(const Association *association);
+
+        qint64 now() const { return clock_.nsecsElapsed() / 1000; } // microseconds
+        bool   adopt(Association *association);
+        void   setReady(Association *association);
+        void   takePendingAssociations(Listener *listener);
+        void   scheduleTimeout(Association *association, qint64 delay);
+        void   armTimer();
+        void   processTimeouts();
+
+        std::shared_ptr<CookieSecret> secret_;
+        FlatHash<Association *>       associations_; // (local port, remote port, local verification tag) => association
+        std::map<quint16, Listener *> listeners_;
+        std::deque<Association *>     ready_;  // have outgoing packets
+        std::vector<TimerEntry>       timers_; // min-heap. stale entries are skipped when popped
+        QElapsedTimer                 clock_;
+        QTimer *                      timer_;
+        qint64                        armedDeadline_ = -1;
+        quint32                       shardIndex_    = 0;
+        quint32                       shardCount_    = 1;
+    };
+
+}}
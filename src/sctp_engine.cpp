@@ -0,0 +1,201 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_engine.h"
+#include "sctp_common.h"
+#include "sctp_endpoint.h"
+#include "sctp_spsc_queue.h"
+
+#include <QThread>
+#include <QTimer>
+
+namespace SctpDc { namespace Sctp {
+    namespace {
+        template <class F> void post(QObject *context, F f)
+        {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+            QMetaObject::invokeMethod(context, std::move(f), Qt::QueuedConnection);
+#else
+            QTimer::singleShot(0, context, std::move(f));
+#endif
+        }
+    }
+
+    struct Engine::Shard {
+        Shard() : incoming(DefaultQueueSize), outgoing(DefaultQueueSize) { }
+
+        QThread               thread;
+        Endpoint *            endpoint = nullptr;
+        SpscQueue<QByteArray> incoming; // engine => shard
+        SpscQueue<QByteArray> outgoing; // shard => engine
+        std::atomic<bool>     incomingScheduled { false }; // processIncoming() is posted to the shard
+        std::atomic<bool>     outgoingBlocked { false };   // the shard waits for room in outgoing
+
+        // touched by the shard's thread only
+        QByteArray held; // read from the endpoint when outgoing was full
+        bool       flushScheduled = false;
+    };
+
+    Engine::Engine(int threads, QObject *parent) : QObject(parent)
+    {
+        if (threads <= 0) {
+            threads = std::max(1, QThread::idealThreadCount());
+        }
+        for (int i = 0; i < threads; i++) {
+            auto shard      = new Shard;
+            shard->endpoint = new Endpoint;
+            shard->endpoint->setVerificationTagShard(quint32(i), quint32(threads));
+            // batch the output of a whole event loop iteration of the shard
+            connect(shard->endpoint, &Endpoint::readyReadOutgoing, shard->endpoint, [this, shard]() {
+                if (!shard->flushScheduled) {
+                    shard->flushScheduled = true;
+                    post(shard->endpoint, [this, shard]() { flushOutgoing(shard); });
+                }
+            });
+            shard->endpoint->moveToThread(&shard->thread);
+            shard->thread.start();
+            shards_.emplace_back(shard);
+        }
+    }
+
+    Engine::~Engine()
+    {
+        for (const auto &shard : shards_) {
+            auto endpoint = shard->endpoint;
+            post(endpoint, [endpoint]() {
+                delete endpoint;
+                QThread::currentThread()->quit();
+            });
+        }
+        for (const auto &shard : shards_) {
+            shard->thread.wait();
+        }
+    }
+
+    Endpoint *Engine::endpoint(int shard) const { return shards_[size_t(shard)]->endpoint; }
+
+    void Engine::listen(quint16 port)
+    {
+        for (const auto &shard : shards_) {
+            auto endpoint = shard->endpoint;
+            post(endpoint, [endpoint, port]() { endpoint->listen(port); });
+        }
+    }
+
+    void Engine::trimMemory()
+    {
+        for (const auto &shard : shards_) {
+            auto endpoint = shard->endpoint;
+            post(endpoint, [endpoint]() { endpoint->trimMemory(); });
+        }
+    }
+
+    void Engine::writeIncoming(const QByteArray &data)
+    {
+        const Packet pkt(data);
+        if (pkt.size() < Packet::HeaderSize) {
+            return;
+        }
+        auto tag   = pkt.verificationTag();
+        auto shard = shards_[(tag ? tag : nextInitShard_++) % shards_.size()].get();
+
+        QByteArray packet(data);
+        if (!shard->incoming.push(std::move(packet))) {
+            dropped_++;
+            return;
+        }
+        if (!shard->incomingScheduled.exchange(true)) {
+            post(shard->endpoint, [this, shard]() { processIncoming(shard); });
+        }
+    }
+
+    QByteArray Engine::readOutgoing()
+    {
+        QByteArray data;
+        for (int pass = 0; pass < 2; pass++) {
+            // round robin, so a busy shard doesn't starve the others
+            for (size_t i = 0; i < shards_.size(); i++) {
+                auto shard         = shards_[nextOutgoingShard_].get();
+                nextOutgoingShard_ = (nextOutgoingShard_ + 1) % shards_.size();
+                if (shard->outgoing.pop(data)) {
+                    if (shard->outgoingBlocked.load() && shard->outgoingBlocked.exchange(false)) {
+                        post(shard->endpoint, [this, shard]() { flushOutgoing(shard); });
+                    }
+                    return data;
+                }
+            }
+            // all empty. from now on the shards have to notify again. check once more for what they have pushed
+            // before seeing the flag
+            outgoingNotified_ = false;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        return data;
+    }
+
+    void Engine::processIncoming(Shard *shard)
+    {
+        QByteArray data;
+        for (;;) {
+            while (shard->incoming.pop(data)) {
+                shard->endpoint->writeIncoming(data);
+            }
+            shard->incomingScheduled = false;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            // something may have been pushed after the last pop but before the engine could see the flag
+            if (shard->incoming.isEmpty() || shard->incomingScheduled.exchange(true)) {
+                break;
+            }
+        }
+        flushOutgoing(shard);
+    }
+
+    void Engine::flushOutgoing(Shard *shard)
+    {
+        shard->flushScheduled = false;
+        bool pushed           = false;
+        for (;;) {
+            if (shard->held.isEmpty()) {
+                shard->held = shard->endpoint->readOutgoing();
+                if (shard->held.isEmpty()) {
+                    break;
+                }
+            }
+            if (shard->outgoing.push(std::move(shard->held))) {
+                shard->held = QByteArray();
+                pushed      = true;
+                continue;
+            }
+            // full. the engine posts another flush when it reads something, unless it has done so already
+            shard->outgoingBlocked = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (shard->outgoing.isFull() || !shard->outgoingBlocked.exchange(false)) {
+                break;
+            }
+        }
+        if (pushed && !outgoingNotified_.exchange(true)) {
+            post(this, [this]() { emit readyReadOutgoing(); });
+        }
+    }
+
+}}
@@ -0,0 +1,89 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include <QObject>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace SctpDc { namespace Sctp {
+
+    class Endpoint;
+
+    // Associations sharded across worker threads, each shard is an Endpoint running in its own thread. The shard of a
+    // packet is its verification tag modulo the number of shards, and the endpoints pick local tags accordingly. INITs
+    // have no tag yet and are spread round robin, the tag chosen by the answering shard brings the rest back to it.
+    //
+    // The thread the engine lives in does the I/O. Packets are passed to and from the shards over single producer /
+    // single consumer lock-free queues and no lock is taken per packet. The other side is woken up with a queued call
+    // only when it may have gone idle, so a busy engine makes about one wake-up per burst.
+    class Engine : public QObject {
+        Q_OBJECT
+    public:
+        constexpr static quint32 DefaultQueueSize = 4096; // packets per direction and shard
+
+        // threads <= 0 means one per core
+        explicit Engine(int threads = 0, QObject *parent = nullptr);
+        ~Engine() override;
+
+        int shardsCount() const { return int(shards_.size()); }
+
+        // the endpoint lives in the shard's thread and has to be used from there only, e.g. with queued invocations
+        // or connections with context objects of that thread
+        Endpoint *endpoint(int shard) const;
+
+        // accept incoming associations on all the shards
+        void listen(quint16 port);
+
+        // Endpoint::trimMemory() in all the shards. asynchronous, so it may be called from any thread
+        void trimMemory();
+
+        // the same as with Endpoint, called from the engine's thread only
+        QByteArray readOutgoing();
+        void       writeIncoming(const QByteArray &data);
+
+        // incoming packets dropped because the shard was behind and its queue was full. SCTP recovers as from any
+        // network loss
+        quint64 droppedPackets() const { return dropped_; }
+
+    signals:
+        void readyReadOutgoing();
+
+    private:
+        struct Shard;
+
+        void processIncoming(Shard *shard); // in the shard's thread
+        void flushOutgoing(Shard *shard);   // in the shard's thread
+
+        std::vector<std::unique_ptr<Shard>> shards_;
+        std::atomic<bool>                   outgoingNotified_ { false }; // readyReadOutgoing() is on its way
+        quint32                             nextInitShard_     = 0;
+        size_t                              nextOutgoingShard_ = 0;
+        quint64                             dropped_           = 0;
+    };
+
+}}
@@ -0,0 +1,136 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <vector>
+
+namespace SctpDc { namespace Sctp {
+
+    // Open addressing hash map with linear probing for non-zero 64-bit keys, zero marks empty slots. Lookups touch one
+    // or a few adjacent slots of a flat array, deletion shifts the following entries back, so no tombstones.
+    template <class T> class FlatHash {
+    public:
+        FlatHash() { rehash(16); }
+
+        int  size() const { return size_; }
+        bool isEmpty() const { return size_ == 0; }
+
+        T *find(quint64 key)
+        {
+            if (!key) {
+                return nullptr; // would match an empty slot
+            }
+            for (auto i = index(key);; i = (i + 1) & mask_) {
+                if (slots_[i].key == key)
+                    return &slots_[i].value;
+                if (!slots_[i].key)
+                    return nullptr;
+            }
+        }
+        const T *find(quint64 key) const { return const_cast<FlatHash *>(this)->find(key); }
+
+        // returns false if the key is already there
+        bool insert(quint64 key, const T &value)
+        {
+            Q_ASSERT(key);
+            if ((size_ + 1) * 4 > int(slots_.size()) * 3) {
+                rehash(slots_.size() * 2);
+            }
+            auto i = index(key);
+            for (; slots_[i].key; i = (i + 1) & mask_) {
+                if (slots_[i].key == key)
+                    return false;
+            }
+            slots_[i] = { key, value };
+            size_++;
+            return true;
+        }
+
+        bool erase(quint64 key)
+        {
+            if (!key) {
+                return false;
+            }
+            auto i = index(key);
+            for (; slots_[i].key != key; i = (i + 1) & mask_) {
+                if (!slots_[i].key)
+                    return false;
+            }
+            // move back the entries which would be unreachable otherwise
+            for (auto j = (i + 1) & mask_; slots_[j].key; j = (j + 1) & mask_) {
+                auto home = index(slots_[j].key);
+                if (((j - home) & mask_) >= ((j - i) & mask_)) {
+                    slots_[i] = slots_[j];
+                    i         = j;
+                }
+            }
+            slots_[i] = Slot();
+            size_--;
+            return true;
+        }
+
+        template <class F> void forEach(F f) const
+        {
+            for (const auto &slot : slots_) {
+                if (slot.key)
+                    f(slot.key, slot.value);
+            }
+        }
+
+    private:
+        struct Slot {
+            quint64 key = 0;
+            T       value {};
+        };
+
+        // fibonacci hashing. takes the high bits, so even sequential keys spread well
+        quint32 index(quint64 key) const { return quint32((key * 0x9E3779B97F4A7C15ull) >> shift_); }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<Slot> old;
+            old.swap(slots_);
+            slots_.resize(capacity);
+            mask_  = quint32(capacity - 1);
+            shift_ = 64;
+            for (auto c = capacity; c > 1; c >>= 1) {
+                shift_--;
+            }
+            size_ = 0;
+            for (const auto &slot : old) {
+                if (slot.key)
+                    insert(slot.key, slot.value);
+            }
+        }
+
+        std::vector<Slot> slots_;
+        int               size_  = 0;
+        quint32           mask_  = 0;
+        int               shift_ = 64;
+    };
+
+}}
@@ -0,0 +1,155 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_listener.h"
+#include "sctp_association.h"
+#include "sctp_chunk.h"
+#include "sctp_parameter.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#include <QRandomGenerator>
+#endif
+
+namespace SctpDc { namespace Sctp {
+    namespace {
+        quint32 random32()
+        {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+            return QRandomGenerator::global()->generate();
+#else
+            return quint32(qrand());
+#endif
+        }
+    }
+
+    Listener::Listener(quint16 port, QObject *parent) :
+        QObject(parent), port_(port), secret_(std::make_shared<CookieSecret>())
+    {
+    }
+
+    Listener::~Listener() = default;
+
+    QByteArray Listener::readOutgoing()
+    {
+        if (outgoingPackets_.empty()) {
+            return QByteArray();
+        }
+        QByteArray data = std::move(outgoingPackets_.front());
+        outgoingPackets_.pop_front();
+        return data;
+    }
+
+    Association *Listener::nextPendingAssociation()
+    {
+        if (pendingAssociations_.empty()) {
+            return nullptr;
+        }
+        auto association = pendingAssociations_.front();
+        pendingAssociations_.pop_front();
+        return association;
+    }
+
+    void Listener::writeIncoming(const QByteArray &data)
+    {
+        const Packet pkt(data);
+        if (!pkt.isValidSctp() || pkt.destinationPort() != port_) {
+            return;
+        }
+        auto it = pkt.begin();
+        if (it == pkt.end()) {
+            return;
+        }
+        const auto chunk = *it;
+        if (!chunk.isValid()) {
+            return;
+        }
+
+        if (chunk.type() == InitChunk::Type) {
+            // RFC 4960 8.5.1. INIT has zero tag and has to be the only chunk in the packet
+            if (pkt.verificationTag() || !chunk.as<InitChunk>().isValid() || ++it != pkt.end()) {
+                return;
+            }
+            incomingInit(chunk.as<InitChunk>(), pkt.sourcePort());
+            return;
+        }
+
+        if (chunk.type() == CookieEchoChunk::Type) {
+            StateCookie cookie;
+            if (!secret_->openCookie(chunk.as<CookieEchoChunk>().value(), cookie)
+                || cookie.myVerificationTag != pkt.verificationTag() || cookie.sourcePort != port_
+                || cookie.destinationPort != pkt.sourcePort()) {
+                return; // forged, expired or not ours
+            }
+            auto association = new Association(cookie.sourcePort, cookie.destinationPort, this);
+            association->setCookieSecret(secret_);
+            association->acceptCookieEcho(data, cookie);
+            if (association->state() != Association::State::Established) {
+                delete association;
+                return;
+            }
+            pendingAssociations_.push_back(association);
+            emit newAssociation();
+        }
+        // anything else belongs to some association or is out of the blue
+    }
+
+    void Listener::incomingInit(const InitChunk &chunk, quint16 peerPort)
+    {
+        if (!chunk.initiateTag()) {
+            return;
+        }
+
+        StateCookie cookie;
+        cookie.myVerificationTag    = shardVerificationTag(random32(), shardIndex_, shardCount_);
+        cookie.peerVerificationTag  = chunk.initiateTag();
+        cookie.myInitialTsn         = random32();
+        cookie.peerInitialTsn       = chunk.initialTsn();
+        cookie.peerWindowCredit     = chunk.receiverWindowCredit();
+        cookie.inboundStreamsCount  = chunk.outboundStreamsCount();
+        cookie.outboundStreamsCount = chunk.inboundStreamsCount();
+        cookie.sourcePort           = port_;
+        cookie.destinationPort      = peerPort;
+        const auto extensions       = chunk.parameter<SupportedExtensionsParameter>();
+        cookie.peerNrSack           = extensions.isValid() && extensions.value().contains(char(NrSackChunk::Type));
+        cookie.peerReconfig         = extensions.isValid() && extensions.value().contains(char(ReconfigChunk::Type));
+
+        Packet packet;
+        auto   ack = packet.appendChunk<InitAckChunk>();
+        ack.setInitiateTag(cookie.myVerificationTag);
+        ack.setInitialTsn(cookie.myInitialTsn);
+        ack.setReceiverWindowCredit(Association::InitialReceiveWindow);
+        ack.setInboundStreamsCount(cookie.inboundStreamsCount);
+        ack.setOutboundStreamsCount(cookie.outboundStreamsCount);
+        ack.appendParameter<SupportedExtensionsParameter>(supportedExtensions());
+        ack.appendParameter<CookieParameter>(secret_->makeCookie(cookie));
+        packet.setVerificationTag(cookie.peerVerificationTag);
+        packet.setSourcePort(port_);
+        packet.setDestinationPort(peerPort);
+        packet.setChecksum();
+
+        outgoingPackets_.push_back(packet.takeData());
+        emit readyReadOutgoing();
+    }
+
+}}
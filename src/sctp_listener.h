@@ -0,0 +1,84 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include "sctp_cookie.h"
+
+#include <QObject>
+
+#include <deque>
+#include <memory>
+
+namespace SctpDc { namespace Sctp {
+
+    class Association;
+    class InitChunk;
+
+    // Stateless server side of the handshake (RFC 4960 5.1.3). INITs are answered right away with a cookie signed by
+    // the endpoint-wide secret and nothing is kept about the peer. An Association is allocated only when a valid
+    // COOKIE-ECHO comes back, so INIT floods and abandoned handshakes cost CPU but not memory.
+    class Listener : public QObject {
+        Q_OBJECT
+    public:
+        Listener(quint16 port, QObject *parent = nullptr);
+        ~Listener() override;
+
+        void                          setCookieSecret(std::shared_ptr<CookieSecret> secret) { secret_ = std::move(secret); }
+        std::shared_ptr<CookieSecret> cookieSecret() const { return secret_; }
+
+        // local verification tags are chosen so tag % count == index. see Engine
+        void setVerificationTagShard(quint32 index, quint32 count)
+        {
+            shardIndex_ = index;
+            shardCount_ = count;
+        }
+
+        // read INIT-ACKs to be sent to the network
+        QByteArray readOutgoing();
+
+        // data - an sctp packet right from network. packets of established associations have to be passed to them
+        // directly
+        void writeIncoming(const QByteArray &data);
+
+        // established associations are parented to the listener. the caller takes the ownership
+        bool         hasPendingAssociations() const { return !pendingAssociations_.empty(); }
+        Association *nextPendingAssociation();
+
+    signals:
+        void readyReadOutgoing();
+        void newAssociation();
+
+    private:
+        void incomingInit(const InitChunk &chunk, quint16 peerPort);
+
+        quint16                       port_;
+        std::shared_ptr<CookieSecret> secret_;
+        std::deque<QByteArray>        outgoingPackets_;
+        std::deque<Association *>     pendingAssociations_;
+        quint32                       shardIndex_ = 0;
+        quint32                       shardCount_ = 1;
+    };
+
+}}
@@ -26,12 +26,100 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "sctp_common.h"
 
+#include <QList>
+
 namespace SctpDc { namespace Sctp {
     class CookieParameter : public Parameter {
     public:
-        constexpr static quint8 Type = 0;
+        constexpr static quint16 Type = 7;
+
+        using Parameter::Parameter;
+    };
+
+    // Opaque to the peer, which echoes it back. Ours carry a nonce, the send time in microseconds and the probe size
+    // of path mtu probes (0 for keepalives)
+    class HeartbeatInfoParameter : public Parameter {
+    public:
+        constexpr static quint16 Type          = 1;
+        constexpr static int     MinHeaderSize = 24;
+
+        using Parameter::Parameter;
+
+        inline quint64 nonce() const { return qFromBigEndian<quint64>(data.constData() + offset + 4); }
+        inline void    setNonce(quint64 nonce) { qToBigEndian(nonce, data.data() + offset + 4); }
+
+        inline qint64 timestamp() const { return qint64(qFromBigEndian<quint64>(data.constData() + offset + 12)); }
+        inline void   setTimestamp(qint64 usecs) { qToBigEndian(quint64(usecs), data.data() + offset + 12); }
+
+        inline quint32 probeSize() const { return qFromBigEndian<quint32>(data.constData() + offset + 20); }
+        inline void    setProbeSize(quint32 size) { qToBigEndian(size, data.data() + offset + 20); }
+    };
+
+    // RFC 5061 4.2.7. chunk types of extensions the sender supports, one byte each
+    class SupportedExtensionsParameter : public Parameter {
+    public:
+        constexpr static quint16 Type = 0x8008;
 
         using Parameter::Parameter;
     };
 
+    // RFC 6525 4.1. the sender resets its outgoing streams once the peer got everything up to the last assigned tsn.
+    // no streams means all of them
+    class OutgoingSsnResetRequestParameter : public Parameter {
+    public:
+        constexpr static quint16 Type          = 13;
+        constexpr static int     MinHeaderSize = 16;
+
+        using Parameter::Parameter;
+
+        inline quint32 requestSequence() const { return qFromBigEndian<quint32>(data.constData() + offset + 4); }
+        inline void    setRequestSequence(quint32 seq) { qToBigEndian(seq, data.data() + offset + 4); }
+
+        inline quint32 responseSequence() const { return qFromBigEndian<quint32>(data.constData() + offset + 8); }
+        inline void    setResponseSequence(quint32 seq) { qToBigEndian(seq, data.data() + offset + 8); }
+
+        inline quint32 lastAssignedTsn() const { return qFromBigEndian<quint32>(data.constData() + offset + 12); }
+        inline void    setLastAssignedTsn(quint32 tsn) { qToBigEndian(tsn, data.data() + offset + 12); }
+
+        QList<quint16> streams() const
+        {
+            QList<quint16> streams;
+            for (int pos = MinHeaderSize; pos + 2 <= size; pos += 2) {
+                streams.append(qFromBigEndian<quint16>(data.constData() + offset + pos));
+            }
+            return streams;
+        }
+        void setStreams(const QList<quint16> &streams)
+        {
+            for (int i = 0; i < streams.size(); i++) {
+                qToBigEndian(streams[i], data.data() + offset + MinHeaderSize + i * 2);
+            }
+        }
+    };
+
+    // RFC 6525 4.4
+    class ReconfigResponseParameter : public Parameter {
+    public:
+        constexpr static quint16 Type          = 16;
+        constexpr static int     MinHeaderSize = 12;
+
+        enum Result : quint32 {
+            NothingToDo,
+            Performed,
+            Denied,
+            WrongSsn,
+            RequestInProgress, // another request is not finished yet
+            BadSequenceNumber,
+            InProgress // deferred. the request has to be repeated later
+        };
+
+        using Parameter::Parameter;
+
+        inline quint32 responseSequence() const { return qFromBigEndian<quint32>(data.constData() + offset + 4); }
+        inline void    setResponseSequence(quint32 seq) { qToBigEndian(seq, data.data() + offset + 4); }
+
+        inline quint32 result() const { return qFromBigEndian<quint32>(data.constData() + offset + 8); }
+        inline void    setResult(quint32 result) { qToBigEndian(result, data.data() + offset + 8); }
+    };
+
 }}
@@ -0,0 +1,94 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#include "sctp_siphash.h"
+
+#include <QtEndian>
+
+namespace SctpDc { namespace Sctp {
+    namespace {
+        inline quint64 rotl(quint64 x, int b) { return (x << b) | (x >> (64 - b)); }
+
+        struct SipState {
+            quint64 v0, v1, v2, v3;
+
+            inline void round()
+            {
+                v0 += v1;
+                v1 = rotl(v1, 13);
+                v1 ^= v0;
+                v0 = rotl(v0, 32);
+                v2 += v3;
+                v3 = rotl(v3, 16);
+                v3 ^= v2;
+                v0 += v3;
+                v3 = rotl(v3, 21);
+                v3 ^= v0;
+                v2 += v1;
+                v1 = rotl(v1, 17);
+                v1 ^= v2;
+                v2 = rotl(v2, 32);
+            }
+
+            inline void compress(quint64 m)
+            {
+                v3 ^= m;
+                round();
+                round();
+                v0 ^= m;
+            }
+
+            inline quint64 finalize(quint8 marker)
+            {
+                v2 ^= marker;
+                round();
+                round();
+                round();
+                round();
+                return v0 ^ v1 ^ v2 ^ v3;
+            }
+        };
+    }
+
+    void sipHash128(const quint64 key[2], const char *data, int size, char *out)
+    {
+        SipState s { key[0] ^ 0x736f6d6570736575ull, key[1] ^ 0x646f72616e646f6dull ^ 0xee,
+                     key[0] ^ 0x6c7967656e657261ull, key[1] ^ 0x7465646279746573ull };
+
+        const int tail = size & 7;
+        for (const char *end = data + size - tail; data != end; data += 8) {
+            s.compress(qFromLittleEndian<quint64>(data));
+        }
+        quint64 last = quint64(size) << 56;
+        for (int i = 0; i < tail; i++) {
+            last |= quint64(quint8(data[i])) << (8 * i);
+        }
+        s.compress(last);
+
+        qToLittleEndian(s.finalize(0xee), out);
+        s.v1 ^= 0xdd;
+        qToLittleEndian(s.finalize(0), out + 8);
+    }
+
+}}
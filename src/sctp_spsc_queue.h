@@ -0,0 +1,102 @@
+#if 0
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#endif
+
+#pragma once
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace SctpDc { namespace Sctp {
+
+    // Bounded lock-free queue for exactly one producer thread and one consumer thread. Each side owns its index and
+    // keeps a cached copy of the other one, so the shared cache lines are touched only when the cached view runs out.
+    template <class T> class SpscQueue {
+    public:
+        // the capacity is rounded up to a power of two
+        explicit SpscQueue(quint32 capacity) : items_(roundUp(capacity)), mask_(quint32(items_.size() - 1)) { }
+
+        // producer only. returns false and leaves the value untouched if the queue is full
+        bool push(T &&value)
+        {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            if (tail - cachedHead_ > mask_) {
+                cachedHead_ = head_.load(std::memory_order_acquire);
+                if (tail - cachedHead_ > mask_)
+                    return false;
+            }
+            items_[tail & mask_] = std::move(value);
+            tail_.store(tail + 1, std::memory_order_release);
+            return true;
+        }
+
+        // consumer only
+        bool pop(T &value)
+        {
+            auto head = head_.load(std::memory_order_relaxed);
+            if (head == cachedTail_) {
+                cachedTail_ = tail_.load(std::memory_order_acquire);
+                if (head == cachedTail_)
+                    return false;
+            }
+            value                = std::move(items_[head & mask_]);
+            items_[head & mask_] = T(); // don't keep a moved-from value alive in the slot
+            head_.store(head + 1, std::memory_order_release);
+            return true;
+        }
+
+        // exact for the calling side as far as the other side is concerned
+        bool isEmpty() const { return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire); }
+        bool isFull() const
+        {
+            return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire) > mask_;
+        }
+
+    private:
+        static size_t roundUp(quint32 capacity)
+        {
+            size_t size = 2;
+            while (size < capacity)
+                size <<= 1;
+            return size;
+        }
+
+        constexpr static int CacheLineSize = 64;
+
+        std::vector<T> items_;
+        quint32        mask_;
+
+        // producer and consumer indices live on separate cache lines
+        char                 pad0_[CacheLineSize];
+        std::atomic<quint32> tail_ { 0 };
+        quint32              cachedHead_ = 0; // producer's view of head_
+        char                 pad1_[CacheLineSize];
+        std::atomic<quint32> head_ { 0 };
+        quint32              cachedTail_ = 0; // consumer's view of tail_
+        char                 pad2_[CacheLineSize];
+    };
+
+}}
@@ -24,23 +24,235 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "sctpdc.h"
 
-#include "sctp_association.h"
+#include "datachannel.h"
+#include "sctp_containers.h"
 
 #include <sctpdc_datagram>
 #include <sctpdc_stream>
 
+#include <algorithm>
+
 namespace SctpDc {
 
 class Connection::Private {
 public:
-    Sctp::Association association;
+    explicit Private(Connection *q) : q(q) { }
+
+    // progress of closing a stream (RFC 8831 6.7). the id is taken until both directions are reset
+    enum ResetFlag : quint8 { ResetRequested = 1, OutgoingReset = 2, IncomingReset = 4 };
+
+    int          allocateStreamId(int negotiatedStreamId);
+    void         addChannel(DataChannel *channel);
+    void         closeChannel(quint16 streamId);
+    void         streamsReset(const QList<quint16> &streamIds, ResetFlag flag);
+    void         releaseStreamId(quint16 streamId); // once the channel is gone and the stream reset both ways
+    void         readIncoming();
+    DataChannel *incomingMessage(Sctp::AssociationCore::Message &&message); // the channel of user data if any
+
+    Connection *                                  q;
+    Sctp::Association                             association { 5000, 5000 }; // the ports WebRTC uses
+    Sctp::SortedVectorMap<quint16, DataChannel *> channels;
+    Sctp::SortedVectorMap<quint16, quint8>        resets; // streams being closed. id => ResetFlag bits
+    DtlsRole                                      dtlsRole     = DtlsRole::Client;
+    quint16                                       nextStreamId = 0;
 };
 
+int Connection::Private::allocateStreamId(int negotiatedStreamId)
+{
+    // the peer throws away data on streams beyond the count it agreed to
+    const int count = association.outboundStreamsCount();
+    if (negotiatedStreamId >= 0) {
+        bool taken = negotiatedStreamId >= count || channels.find(quint16(negotiatedStreamId))
+            || resets.find(quint16(negotiatedStreamId));
+        return taken ? -1 : negotiatedStreamId;
+    }
+    // RFC 8832 6. the DTLS client takes even stream ids and the server odd ones, so both may open at once
+    const int parity = dtlsRole == DtlsRole::Client ? 0 : 1;
+    int       id     = (nextStreamId & ~1) | parity;
+    for (int i = 0; i < (count - parity + 1) / 2; i++, id += 2) {
+        if (id >= count) {
+            id = parity;
+        }
+        if (!channels.find(quint16(id)) && !resets.find(quint16(id))) {
+            nextStreamId = quint16(id + 2);
+            return id;
+        }
+    }
+    return -1;
+}
+
+void Connection::Private::addChannel(DataChannel *channel)
+{
+    auto streamId = channel->streamId;
+    channels[streamId] = channel;
+    QObject::connect(channel->object, &QObject::destroyed, q, [this, streamId]() { closeChannel(streamId); });
+    if (!channel->acked) {
+        channel->sendOpen();
+    }
+}
+
+void Connection::Private::closeChannel(quint16 streamId)
+{
+    if (!channels.erase(streamId)) {
+        return; // the connection is being destroyed
+    }
+    auto &flags = resets[streamId];
+    if (!(flags & ResetRequested)) {
+        if (!association.resetStreams({ streamId })) {
+            resets.erase(streamId); // not established or no stream reset support. nothing to wait for
+            return;
+        }
+        flags |= ResetRequested;
+    }
+    releaseStreamId(streamId);
+}
+
+void Connection::Private::streamsReset(const QList<quint16> &streamIds, ResetFlag flag)
+{
+    for (auto streamId : streamIds) {
+        if (!channels.find(streamId) && !resets.find(streamId)) {
+            continue; // not a channel of ours
+        }
+        auto &flags = resets[streamId];
+        flags |= flag;
+        if (flag == IncomingReset && !(flags & ResetRequested) && association.resetStreams({ streamId })) {
+            flags |= ResetRequested; // closed by the peer, so our side is closed as well
+        }
+        releaseStreamId(streamId);
+    }
+}
+
+void Connection::Private::releaseStreamId(quint16 streamId)
+{
+    auto flags = resets.find(streamId);
+    if (flags && !channels.find(streamId) && (*flags & OutgoingReset) && (*flags & IncomingReset)) {
+        resets.erase(streamId);
+    }
+}
+
+void Connection::Private::readIncoming()
+{
+    // the association notifies once per incoming batch and so do the channels
+    std::vector<quint16> ready;
+    while (association.hasPendingMessages()) {
+        auto channel = incomingMessage(association.takeIncoming());
+        if (channel && std::find(ready.begin(), ready.end(), channel->streamId) == ready.end()) {
+            ready.push_back(channel->streamId);
+        }
+    }
+    for (auto streamId : ready) {
+        auto channel = channels.find(streamId); // may be deleted by a previous readyRead handler
+        if (channel) {
+            (*channel)->notifyIncoming();
+        }
+    }
+}
+
+DataChannel *Connection::Private::incomingMessage(Sctp::AssociationCore::Message &&message)
+{
+    auto found   = channels.find(message.streamId);
+    auto channel = found ? *found : nullptr;
+    if (Dcep::ppid(message.payloadProto) != Dcep::ControlPpid) {
+        if (channel) {
+            channel->acked = true; // the peer sends data only after it got the OPEN (RFC 8832 6)
+            channel->incomingMessage(std::move(message)); // consumed from the association as the channel is read
+        } else {
+            association.consumeIncoming(message.streamId, quint32(message.data.size()));
+        }
+        return channel;
+    }
+    association.consumeIncoming(message.streamId, quint32(message.data.size()));
+    if (message.data.isEmpty()) {
+        return nullptr;
+    }
+    if (quint8(message.data[0]) == Dcep::Ack) {
+        if (channel) {
+            channel->acked = true;
+        }
+        return nullptr;
+    }
+    Dcep::OpenMessage open;
+    if (channel || !open.parse(message.data)) {
+        return nullptr; // the stream is taken or a malformed OPEN
+    }
+    // the ACK goes first and ordered, so our data may follow it right away with the channel's own ordering
+    association.write(message.streamId, false, Dcep::ppid(Dcep::ControlPpid), QByteArray(1, char(Dcep::Ack)));
+    auto label = QString::fromUtf8(open.label);
+    if (open.channelType & Dcep::UnorderedFlag) {
+        auto datagram = new DatagramChannel(&association, message.streamId, label, true, q);
+        addChannel(datagram->dataChannel());
+        emit q->newDatagramChannel(datagram);
+    } else {
+        auto stream = new StreamChannel(&association, message.streamId, label, true, q);
+        addChannel(stream->dataChannel());
+        emit q->newStreamChannel(stream);
+    }
+    return nullptr;
+}
+
+Connection::Connection(QObject *parent) : QObject(parent), d(new Private(this))
+{
+    auto &association = d->association;
+    connect(&association, &Sctp::Association::readyReadOutgoing, this, &Connection::readyReadOutgoing);
+    connect(&association, &Sctp::Association::established, this, &Connection::connected);
+    connect(&association, &Sctp::Association::errorOccured, this, [this]() {
+        if (d->association.state() == Sctp::Association::State::Closed) {
+            emit disconnected();
+        }
+    });
+    connect(&association, &Sctp::Association::readyReadIncoming, this, [this]() { d->readIncoming(); });
+    connect(&association, &Sctp::Association::outgoingStreamsReset, this,
+            [this](const QList<quint16> &streamIds) { d->streamsReset(streamIds, Private::OutgoingReset); });
+    connect(&association, &Sctp::Association::incomingStreamsReset, this,
+            [this](const QList<quint16> &streamIds) { d->streamsReset(streamIds, Private::IncomingReset); });
+}
+
+Connection::~Connection()
+{
+    // the channels are children and would outlive the association otherwise. taken out of the map first, so their
+    // streams are not reset for nothing
+    while (!d->channels.empty()) {
+        auto object = d->channels.begin()->second->object;
+        d->channels.erase(d->channels.begin()->first);
+        delete object;
+    }
+}
+
+void Connection::setDtlsRole(DtlsRole role) { d->dtlsRole = role; }
+
+Connection::DtlsRole Connection::dtlsRole() const { return d->dtlsRole; }
+
 void Connection::associate() { d->association.associate(); }
 
-StreamChannel *Connection::makeStreamChannel() { return nullptr; }
+QByteArray Connection::readOutgoing() { return d->association.readOutgoing(); }
+
+void Connection::writeIncoming(const QByteArray &data) { d->association.writeIncoming(data); }
+
+void Connection::writeIncoming(const QList<QByteArray> &packets) { d->association.writeIncoming(packets); }
 
-DatagramChannel *Connection::makeDatagramChannel() { return nullptr; }
+StreamChannel *Connection::makeStreamChannel(const QString &label, int negotiatedStreamId)
+{
+    int streamId;
+    if (d->association.state() == Sctp::Association::State::Closed
+        || (streamId = d->allocateStreamId(negotiatedStreamId)) < 0) {
+        return nullptr;
+    }
+    auto channel = new StreamChannel(&d->association, quint16(streamId), label, negotiatedStreamId >= 0, this);
+    d->addChannel(channel->dataChannel());
+    return channel;
+}
+
+DatagramChannel *Connection::makeDatagramChannel(const QString &label, int negotiatedStreamId)
+{
+    int streamId;
+    if (d->association.state() == Sctp::Association::State::Closed
+        || (streamId = d->allocateStreamId(negotiatedStreamId)) < 0) {
+        return nullptr;
+    }
+    auto channel = new DatagramChannel(&d->association, quint16(streamId), label, negotiatedStreamId >= 0, this);
+    d->addChannel(channel->dataChannel());
+    return channel;
+}
 
 bool minimalValidation(const QByteArray &data, uint16_t &sourcePort, uint16_t &destinationPort)
 {
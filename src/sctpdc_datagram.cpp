@@ -24,8 +24,136 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "sctpdc_datagram.h"
 
+#include "datachannel.h"
+#include "sctp_containers.h"
+
+#include <algorithm>
+
 namespace SctpDc {
 
-DatagramChannel::DatagramChannel(QObject *parent) : QObject(parent) { }
+class DatagramChannel::Private : public DataChannel {
+public:
+    Private(DatagramChannel *q, Sctp::Association *association, quint16 streamId, const QString &label,
+            bool negotiated) :
+        DataChannel(association, streamId, Dcep::UnorderedFlag, label, negotiated),
+        q(q)
+    {
+        object = q;
+    }
+
+    ~Private() override
+    {
+        quint32 unread = 0;
+        for (size_t i = 0; i < messages.size(); i++) {
+            unread += quint32(messages[i].data.size());
+        }
+        if (unread) {
+            association->consumeIncoming(streamId, unread);
+        }
+    }
+
+    void incomingMessage(Sctp::AssociationCore::Message &&message) override
+    {
+        Message incoming;
+        switch (Dcep::ppid(message.payloadProto)) {
+        case Dcep::StringPpid:
+            incoming.type = String;
+            break;
+        case Dcep::StringEmptyPpid:
+            incoming.type = StringEmpty;
+            break;
+        case Dcep::BinaryEmptyPpid:
+            incoming.type = BinaryEmpty;
+            break;
+        default:
+            incoming.type = Binary;
+        }
+        // the empty ones carry a placeholder byte. an empty but not null array tells it from nothing to read
+        if (incoming.type == StringEmpty || incoming.type == BinaryEmpty) {
+            association->consumeIncoming(streamId, quint32(message.data.size()));
+            incoming.data = QByteArray("");
+        } else {
+            incoming.data = std::move(message.data);
+        }
+        messages.push_back(std::move(incoming));
+    }
+
+    // the next message. its bytes are given back to the association's receive window
+    Message take()
+    {
+        Message message = std::move(messages.front());
+        messages.pop_front();
+        if (!message.data.isEmpty()) {
+            association->consumeIncoming(streamId, quint32(message.data.size()));
+        }
+        return message;
+    }
+
+    void notifyIncoming() override { emit q->readyRead(); }
+
+    DatagramChannel *        q;
+    Sctp::RingQueue<Message> messages;
+};
+
+DatagramChannel::DatagramChannel(Sctp::Association *association, quint16 streamId, const QString &label,
+                                 bool negotiated, QObject *parent) :
+    QObject(parent),
+    d(new Private(this, association, streamId, label, negotiated))
+{
+    connect(association, &Sctp::Association::streamBufferedAmountLow, this, [this](quint16 streamId) {
+        if (streamId == d->streamId)
+            emit bufferedAmountLow();
+    });
+}
+
+DatagramChannel::~DatagramChannel() = default;
+
+quint16 DatagramChannel::streamId() const { return d->streamId; }
+
+QString DatagramChannel::label() const { return d->label; }
+
+DataChannel *DatagramChannel::dataChannel() const { return d.get(); }
+
+quint64 DatagramChannel::bufferedAmount() const { return d->association->bufferedAmount(d->streamId); }
+
+void DatagramChannel::setBufferedAmountLowThreshold(quint64 bytes)
+{
+    d->association->setBufferedAmountLowThreshold(d->streamId, bytes);
+}
+
+quint64 DatagramChannel::bufferedAmountLowThreshold() const
+{
+    return d->association->bufferedAmountLowThreshold(d->streamId);
+}
+
+bool DatagramChannel::hasPendingMessages() const { return !d->messages.empty(); }
+
+DatagramChannel::Message DatagramChannel::readMessage()
+{
+    if (d->messages.empty()) {
+        return Message();
+    }
+    return d->take();
+}
+
+QList<DatagramChannel::Message> DatagramChannel::readMessages(int max)
+{
+    auto count = max < 0 ? d->messages.size() : std::min(size_t(max), d->messages.size());
+    QList<Message> messages;
+    messages.reserve(int(count));
+    for (size_t i = 0; i < count; i++) {
+        messages.append(d->take());
+    }
+    return messages;
+}
+
+bool DatagramChannel::sendMessage(const QByteArray &data, PayloadType type)
+{
+    bool string = type == String || type == StringEmpty;
+    if (data.isEmpty()) {
+        return d->send(string ? Dcep::StringEmptyPpid : Dcep::BinaryEmptyPpid, QByteArray(1, 0));
+    }
+    return d->send(string ? Dcep::StringPpid : Dcep::BinaryPpid, data);
+}
 
 }
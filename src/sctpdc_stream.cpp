@@ -24,10 +24,163 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "sctpdc_stream.h"
 
+#include "datachannel.h"
+#include "sctp_containers.h"
+
+#include <algorithm>
+
 namespace SctpDc {
 
-qint64 StreamChannel::writeData(const char *data, qint64 maxSize) { return 0; }
+class StreamChannel::Private : public DataChannel {
+public:
+    Private(StreamChannel *q, Sctp::Association *association, quint16 streamId, const QString &label,
+            bool negotiated) :
+        DataChannel(association, streamId, Dcep::ReliableChannel, label, negotiated),
+        q(q)
+    {
+        object = q;
+    }
+
+    ~Private() override
+    {
+        if (available) {
+            association->consumeIncoming(streamId, quint32(available)); // unread
+        }
+    }
+
+    void incomingMessage(Sctp::AssociationCore::Message &&message) override
+    {
+        if (message.data.isEmpty() || Dcep::ppid(message.payloadProto) == Dcep::StringEmptyPpid
+            || Dcep::ppid(message.payloadProto) == Dcep::BinaryEmptyPpid) {
+            association->consumeIncoming(streamId, quint32(message.data.size()));
+            return;
+        }
+        available += message.data.size();
+        fragments.push_back(std::move(message.data));
+    }
+
+    void notifyIncoming() override { emit q->readyRead(); }
+
+    // copies up to maxSize bytes out of the fragments. the read ones are dropped if consume is set
+    qint64 copy(char *data, qint64 maxSize, bool consume);
+    // a whole untouched fragment is shared as is, anything else is copied out
+    QByteArray take(qint64 maxSize, bool consume);
+
+    StreamChannel *             q;
+    Sctp::RingQueue<QByteArray> fragments;      // received payloads, shared with the association's reassembly
+    qint64                      available  = 0; // bytes in the fragments not read yet
+    int                         headOffset = 0; // read from the first fragment
+};
+
+qint64 StreamChannel::Private::copy(char *data, qint64 maxSize, bool consume)
+{
+    qint64 done   = 0;
+    int    offset = headOffset;
+    for (size_t i = 0; i < fragments.size() && done < maxSize; i++) {
+        const auto &fragment = fragments[i];
+        auto        size     = std::min(qint64(fragment.size() - offset), maxSize - done);
+        std::copy_n(fragment.constData() + offset, size, data + done);
+        done += size;
+        offset = offset + int(size) == fragment.size() ? 0 : offset + int(size);
+    }
+    if (consume) {
+        for (auto left = done + headOffset; left && left >= fragments.front().size(); fragments.pop_front()) {
+            left -= fragments.front().size();
+        }
+        headOffset = offset;
+        available -= done;
+        association->consumeIncoming(streamId, quint32(done));
+    }
+    return done;
+}
+
+QByteArray StreamChannel::Private::take(qint64 maxSize, bool consume)
+{
+    auto size = std::min(maxSize, available);
+    if (!size) {
+        return QByteArray();
+    }
+    if (!headOffset && fragments.front().size() == size) {
+        QByteArray fragment = fragments.front();
+        if (consume) {
+            fragments.pop_front();
+            available -= size;
+            association->consumeIncoming(streamId, quint32(size));
+        }
+        return fragment;
+    }
+    QByteArray data(int(size), Qt::Uninitialized);
+    copy(data.data(), size, consume);
+    return data;
+}
+
+StreamChannel::StreamChannel(Sctp::Association *association, quint16 streamId, const QString &label, bool negotiated,
+                             QObject *parent) :
+    QIODevice(parent),
+    d(new Private(this, association, streamId, label, negotiated))
+{
+    // QIODevice's own buffer would be one more copy of all the data
+    open(QIODevice::ReadWrite | QIODevice::Unbuffered);
+    connect(association, &Sctp::Association::streamBufferedAmountLow, this, [this](quint16 streamId) {
+        if (streamId == d->streamId)
+            emit bufferedAmountLow();
+    });
+}
+
+StreamChannel::~StreamChannel() = default;
+
+quint16 StreamChannel::streamId() const { return d->streamId; }
+
+QString StreamChannel::label() const { return d->label; }
+
+DataChannel *StreamChannel::dataChannel() const { return d.get(); }
+
+quint64 StreamChannel::bufferedAmount() const { return d->association->bufferedAmount(d->streamId); }
+
+void StreamChannel::setBufferedAmountLowThreshold(quint64 bytes)
+{
+    d->association->setBufferedAmountLowThreshold(d->streamId, bytes);
+}
+
+quint64 StreamChannel::bufferedAmountLowThreshold() const
+{
+    return d->association->bufferedAmountLowThreshold(d->streamId);
+}
+
+bool StreamChannel::isSequential() const { return true; }
+
+qint64 StreamChannel::bytesAvailable() const { return d->available + QIODevice::bytesAvailable(); }
+
+qint64 StreamChannel::bytesToWrite() const { return qint64(bufferedAmount()); }
+
+QByteArray StreamChannel::read(qint64 maxSize) { return isReadable() ? d->take(maxSize, true) : QByteArray(); }
+
+QByteArray StreamChannel::peek(qint64 maxSize) { return isReadable() ? d->take(maxSize, false) : QByteArray(); }
+
+QByteArray StreamChannel::readAll() { return read(d->available); }
+
+qint64 StreamChannel::writeData(const char *data, qint64 maxSize)
+{
+    // the association copies the data right into DATA chunks, so it's passed without a copy of its own
+    const auto limit   = std::max(quint64(SendBufferSize), bufferedAmountLowThreshold() + MaxMessageSize);
+    qint64     written = 0;
+    while (written < maxSize && bufferedAmount() < limit) {
+        auto size = int(std::min(maxSize - written, qint64(MaxMessageSize)));
+        if (!d->send(Dcep::BinaryPpid, QByteArray::fromRawData(data + written, size))) {
+            break;
+        }
+        written += size;
+    }
+    using State = Sctp::Association::State;
+    auto state  = d->association->state();
+    bool closed = state == State::Closed || state == State::ShutdownSent || state == State::ShutdownAckSent;
+    if (!written && maxSize && closed) {
+        setErrorString(QStringLiteral("The association is closed"));
+        return -1;
+    }
+    return written;
+}
 
-qint64 StreamChannel::readData(char *data, qint64 maxSize) { return 0; }
+qint64 StreamChannel::readData(char *data, qint64 maxSize) { return d->copy(data, maxSize, true); }
 
 }
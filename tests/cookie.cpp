@@ -0,0 +1,163 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_association.h"
+#include "sctp_cookie.h"
+#include "sctp_listener.h"
+#include "sctp_siphash.h"
+
+#include <QDataStream>
+#include <QMessageAuthenticationCode>
+#include <QTest>
+
+using namespace SctpDc::Sctp;
+
+class CookieTest : public QObject {
+    Q_OBJECT
+
+    static StateCookie sampleState()
+    {
+        StateCookie state;
+        state.myVerificationTag    = 0x01020304;
+        state.peerVerificationTag  = 0x05060708;
+        state.myInitialTsn         = 100;
+        state.peerInitialTsn       = 200;
+        state.peerWindowCredit     = 65536;
+        state.inboundStreamsCount  = 1024;
+        state.outboundStreamsCount = 2048;
+        state.sourcePort           = 5000;
+        state.destinationPort      = 5001;
+        return state;
+    }
+
+private slots:
+    void sipHashTest()
+    {
+        // reference vectors of SipHash-2-4-128 with key 00 01 .. 0f and message 00 01 .. len-1
+        const quint64 key[2] = { 0x0706050403020100ull, 0x0f0e0d0c0b0a0908ull };
+        char          msg[15];
+        for (int i = 0; i < 15; i++) {
+            msg[i] = char(i);
+        }
+        char out[16];
+        sipHash128(key, msg, 0, out);
+        QCOMPARE(QByteArray(out, 16).toHex(), QByteArray("a3817f04ba25a8e66df67214c7550293"));
+        sipHash128(key, msg, 15, out);
+        QCOMPARE(QByteArray(out, 16).toHex(), QByteArray("5493e99933b0a8117e08ec0f97cfc3d9"));
+    }
+
+    void roundTripTest()
+    {
+        CookieSecret secret;
+        auto         cookie = secret.makeCookie(sampleState());
+        QCOMPARE(cookie.size(), CookieSecret::CookieSize);
+
+        StateCookie state;
+        QVERIFY(secret.openCookie(cookie, state));
+        QCOMPARE(state.myVerificationTag, quint32(0x01020304));
+        QCOMPARE(state.peerVerificationTag, quint32(0x05060708));
+        QCOMPARE(state.myInitialTsn, quint32(100));
+        QCOMPARE(state.peerInitialTsn, quint32(200));
+        QCOMPARE(state.peerWindowCredit, quint32(65536));
+        QCOMPARE(state.inboundStreamsCount, quint16(1024));
+        QCOMPARE(state.outboundStreamsCount, quint16(2048));
+        QCOMPARE(state.sourcePort, quint16(5000));
+        QCOMPARE(state.destinationPort, quint16(5001));
+        QVERIFY(state.age >= 0);
+    }
+
+    void tamperTest()
+    {
+        CookieSecret secret;
+        auto         cookie = secret.makeCookie(sampleState());
+        StateCookie  state;
+        for (int i = 0; i < cookie.size(); i++) {
+            auto forged = cookie;
+            forged[i]   = char(forged.at(i) ^ 0x10);
+            QVERIFY(!secret.openCookie(forged, state));
+        }
+        QVERIFY(!secret.openCookie(cookie.left(cookie.size() - 1), state));
+        QVERIFY(!CookieSecret().openCookie(cookie, state)); // another secret
+    }
+
+    void lifetimeTest()
+    {
+        CookieSecret secret;
+        secret.setCookieLifetime(1);
+        auto cookie = secret.makeCookie(sampleState());
+        QTest::qWait(5);
+        StateCookie state;
+        QVERIFY(!secret.openCookie(cookie, state));
+    }
+
+    // what the cookie used to be: QDataStream serialized TCB signed with HMAC-SHA1
+    void legacyCookieBenchmark()
+    {
+        const QByteArray key(8, 'k');
+        const auto       state = sampleState();
+        QBENCHMARK
+        {
+            QByteArray  tcb;
+            QDataStream tcbStream(&tcb, QIODevice::WriteOnly);
+            tcbStream << state.myVerificationTag << state.peerVerificationTag << state.myInitialTsn
+                      << state.peerInitialTsn << state.inboundStreamsCount << state.outboundStreamsCount;
+            auto cookie = tcb + QMessageAuthenticationCode::hash(tcb, key, QCryptographicHash::Sha1);
+
+            const auto msg = QByteArray::fromRawData(cookie.constData(), cookie.size() - 20);
+            QVERIFY(QMessageAuthenticationCode::hash(msg, key, QCryptographicHash::Sha1)
+                    == QByteArray::fromRawData(cookie.constData() + msg.size(), 20));
+        }
+    }
+
+    void cookieBenchmark()
+    {
+        CookieSecret secret;
+        const auto   state = sampleState();
+        StateCookie  opened;
+        QBENCHMARK
+        {
+            QVERIFY(secret.openCookie(secret.makeCookie(state), opened));
+        }
+    }
+
+    // handshakes per second is 1 / time per iteration
+    void handshakeBenchmark()
+    {
+        Listener listener(5000);
+        QBENCHMARK
+        {
+            Association client(1000, 5000);
+            client.associate();
+            listener.writeIncoming(client.readOutgoing());
+            client.writeIncoming(listener.readOutgoing());
+            listener.writeIncoming(client.readOutgoing());
+            delete listener.nextPendingAssociation();
+            QCOMPARE(client.state(), Association::State::CookieEchoed);
+        }
+    }
+};
+
+QTEST_MAIN(CookieTest)
+
+#include "cookie.moc"
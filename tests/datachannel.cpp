@@ -0,0 +1,387 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "datachannel.h"
+#include "sctp_association.h"
+
+#include <sctpdc>
+#include <sctpdc_datagram>
+#include <sctpdc_stream>
+
+#include <QTest>
+
+#include <algorithm>
+
+using namespace SctpDc;
+
+class DataChannelTest : public QObject {
+    Q_OBJECT
+
+    Connection *client = nullptr;
+    Connection *server = nullptr;
+
+    QList<StreamChannel *>   serverStreams;
+    QList<DatagramChannel *> serverDatagrams;
+
+    const quint64 memoryLimit = Sctp::Association::bufferedMemoryLimit();
+
+    // moves packets one way. returns the number of packets moved
+    int deliver(Connection *from, Connection *to)
+    {
+        int count = 0;
+        for (auto data = from->readOutgoing(); !data.isEmpty(); data = from->readOutgoing()) {
+            to->writeIncoming(data);
+            count++;
+        }
+        return count;
+    }
+
+    void pump()
+    {
+        while (deliver(client, server) + deliver(server, client)) { }
+    }
+
+private slots:
+    void init()
+    {
+        client = new Connection(this);
+        server = new Connection(this);
+        server->setDtlsRole(Connection::DtlsRole::Server);
+        serverStreams.clear();
+        serverDatagrams.clear();
+        connect(server, &Connection::newStreamChannel, this,
+                [this](StreamChannel *channel) { serverStreams.append(channel); });
+        connect(server, &Connection::newDatagramChannel, this,
+                [this](DatagramChannel *channel) { serverDatagrams.append(channel); });
+    }
+
+    void cleanup()
+    {
+        delete client;
+        delete server;
+        Sctp::Association::setBufferedMemoryLimit(memoryLimit);
+    }
+
+    void openMessageTest()
+    {
+        Dcep::OpenMessage open;
+        open.channelType = Dcep::UnorderedFlag;
+        open.priority    = 256;
+        open.label       = "chat";
+        open.protocol    = "xmpp";
+        auto data        = open.serialize();
+        QCOMPARE(data.size(), Dcep::OpenMessage::HeaderSize + 8);
+
+        Dcep::OpenMessage parsed;
+        QVERIFY(parsed.parse(data));
+        QCOMPARE(parsed.channelType, Dcep::UnorderedFlag);
+        QCOMPARE(parsed.priority, quint16(256));
+        QCOMPARE(parsed.label, QByteArray("chat"));
+        QCOMPARE(parsed.protocol, QByteArray("xmpp"));
+        QVERIFY(!parsed.parse(data.left(data.size() - 1)));
+    }
+
+    void notAssociatedTest()
+    {
+        QVERIFY(!client->makeStreamChannel());
+        QVERIFY(!client->makeDatagramChannel());
+    }
+
+    void openTest()
+    {
+        int connected = 0;
+        connect(client, &Connection::connected, this, [&connected]() { connected++; });
+        connect(server, &Connection::connected, this, [&connected]() { connected++; });
+        client->associate();
+        pump();
+        QCOMPARE(connected, 2);
+
+        auto stream   = client->makeStreamChannel("stream");
+        auto datagram = client->makeDatagramChannel("datagram");
+        QVERIFY(stream && datagram);
+        pump();
+        QCOMPARE(serverStreams.size(), 1);
+        QCOMPARE(serverDatagrams.size(), 1);
+        QCOMPARE(serverStreams[0]->label(), QString("stream"));
+        QCOMPARE(serverStreams[0]->streamId(), stream->streamId());
+        QCOMPARE(serverDatagrams[0]->label(), QString("datagram"));
+        QCOMPARE(serverDatagrams[0]->streamId(), datagram->streamId());
+    }
+
+    void immediateSendTest()
+    {
+        client->associate();
+        pump();
+
+        // the data follows the OPEN before the peer had a chance to answer
+        auto stream = client->makeStreamChannel("stream");
+        QCOMPARE(stream->write("hello"), qint64(5));
+        QVERIFY(deliver(client, server));
+        QCOMPARE(serverStreams.size(), 1);
+        QCOMPARE(serverStreams[0]->readAll(), QByteArray("hello"));
+
+        QCOMPARE(serverStreams[0]->write("world"), qint64(5));
+        deliver(server, client);
+        QCOMPARE(stream->readAll(), QByteArray("world"));
+    }
+
+    void streamIdTest()
+    {
+        client->associate();
+        pump();
+
+        auto c1 = client->makeStreamChannel();
+        auto c2 = client->makeDatagramChannel();
+        auto s1 = server->makeStreamChannel();
+        auto s2 = server->makeDatagramChannel();
+        QCOMPARE(c1->streamId(), quint16(0));
+        QCOMPARE(c2->streamId(), quint16(2));
+        QCOMPARE(s1->streamId(), quint16(1));
+        QCOMPARE(s2->streamId(), quint16(3));
+        pump();
+        QCOMPARE(serverStreams.size(), 1);
+        QCOMPARE(serverDatagrams.size(), 1);
+
+        // the stream is taken, also while it's being closed
+        QVERIFY(!client->makeStreamChannel(QString(), 2));
+        delete c2;
+        QVERIFY(!client->makeStreamChannel(QString(), 2));
+        pump();
+        QVERIFY(client->makeStreamChannel(QString(), 2));
+
+        // the peer closed its side in answer and has the id free as soon as its channel is deleted
+        QVERIFY(!server->makeStreamChannel(QString(), 2));
+        delete serverDatagrams[0];
+        QVERIFY(server->makeStreamChannel(QString(), 2));
+    }
+
+    void streamCountTest()
+    {
+        // the client accepts 4 streams only
+        client->associate();
+        auto data = client->readOutgoing();
+        qToBigEndian(quint16(4), data.data() + Sctp::Packet::HeaderSize + 14);
+        Sctp::Packet init(data);
+        init.setChecksum();
+        server->writeIncoming(init.takeData());
+        pump();
+
+        // so the server has ids 1 and 3 to give out and may negotiate no more
+        QCOMPARE(server->makeStreamChannel()->streamId(), quint16(1));
+        QCOMPARE(server->makeDatagramChannel()->streamId(), quint16(3));
+        QVERIFY(!server->makeStreamChannel());
+        QVERIFY(!server->makeStreamChannel(QString(), 4));
+        QVERIFY(server->makeStreamChannel(QString(), 2));
+        QVERIFY(client->makeStreamChannel(QString(), 100));
+    }
+
+    void negotiatedTest()
+    {
+        client->associate();
+        pump();
+
+        auto local  = client->makeStreamChannel("negotiated", 7);
+        auto remote = server->makeStreamChannel("negotiated", 7);
+        QVERIFY(local && remote);
+        QCOMPARE(local->write("ping"), qint64(4));
+        QCOMPARE(remote->write("pong"), qint64(4));
+        pump();
+        QVERIFY(serverStreams.isEmpty());
+        QCOMPARE(remote->readAll(), QByteArray("ping"));
+        QCOMPARE(local->readAll(), QByteArray("pong"));
+    }
+
+    void streamReadTest()
+    {
+        client->associate();
+        pump();
+        auto local  = client->makeStreamChannel("stream", 1);
+        auto remote = server->makeStreamChannel("stream", 1);
+        local->write("abc");
+        local->write("defg");
+        local->write("hi");
+        pump();
+        QCOMPARE(remote->bytesAvailable(), qint64(9));
+
+        // whole payloads are shared, not copied
+        auto peeked = remote->peek(3);
+        auto read   = remote->read(3);
+        QCOMPARE(read, QByteArray("abc"));
+        QCOMPARE(peeked.constData(), read.constData());
+
+        char data[2];
+        QCOMPARE(remote->read(data, 2), qint64(2));
+        QCOMPARE(QByteArray(data, 2), QByteArray("de"));
+        QCOMPARE(remote->peek(10), QByteArray("fghi"));
+        QCOMPARE(remote->bytesAvailable(), qint64(4));
+        QCOMPARE(remote->readAll(), QByteArray("fghi"));
+        QVERIFY(remote->atEnd());
+    }
+
+    void streamBackpressureTest()
+    {
+        client->associate();
+        pump();
+        auto local  = client->makeStreamChannel("stream", 1);
+        auto remote = server->makeStreamChannel("stream", 1);
+        Sctp::Association::setBufferedMemoryLimit(1024 * 1024);
+
+        QByteArray data(4 * 1024 * 1024, 0);
+        for (int i = 0; i < data.size(); i++) {
+            data[i] = char(i % 251);
+        }
+        // the write stops at the memory budget and goes on as the data is acknowledged
+        qint64 written = local->write(data);
+        QVERIFY(written > 0 && written < data.size());
+        QByteArray received;
+        for (int i = 0; i < 1000 && received.size() < data.size(); i++) {
+            pump();
+            received += remote->readAll();
+            auto size = local->write(data.constData() + written, data.size() - written);
+            QVERIFY(size >= 0);
+            written += size;
+            QTest::qWait(1);
+        }
+        QCOMPARE(written, qint64(data.size()));
+        QVERIFY(received == data);
+    }
+
+    void streamSendBufferTest()
+    {
+        client->associate();
+        pump();
+        auto local  = client->makeStreamChannel("stream", 1);
+        auto remote = server->makeStreamChannel("stream", 1);
+        int  low    = 0;
+        connect(local, &StreamChannel::bufferedAmountLow, this, [&low]() { low++; });
+
+        // far below the memory budget, but the write still stops at the channel's send queue
+        QByteArray data(4 * 1024 * 1024, 'a');
+        qint64     written = local->write(data);
+        QVERIFY(written >= StreamChannel::SendBufferSize);
+        QVERIFY(local->bytesToWrite() < StreamChannel::SendBufferSize + StreamChannel::MaxMessageSize);
+        QCOMPARE(local->write(data.constData() + written, data.size() - written), qint64(0));
+
+        // and goes on once the queue is drained
+        qint64 received = 0;
+        for (int i = 0; i < 1000 && received < data.size(); i++) {
+            pump();
+            received += remote->readAll().size();
+            written += local->write(data.constData() + written, data.size() - written);
+            QTest::qWait(1);
+        }
+        QCOMPARE(received, qint64(data.size()));
+        QVERIFY(low > 0);
+    }
+
+    void receiveWindowTest()
+    {
+        client->associate();
+        pump();
+        auto local  = client->makeStreamChannel("stream", 1);
+        auto remote = server->makeStreamChannel("stream", 1);
+
+        // unread data keeps the receive window closed, so the sender is held back instead of the channel growing
+        QByteArray data(1024 * 1024, 'a');
+        qint64     written = local->write(data);
+        for (int i = 0; i < 20; i++) {
+            pump();
+            written += local->write(data.constData() + written, data.size() - written);
+            QTest::qWait(1);
+        }
+        QVERIFY(remote->bytesAvailable() > 0);
+        QVERIFY(remote->bytesAvailable() <= qint64(Sctp::Association::InitialReceiveWindow));
+        QVERIFY(local->bufferedAmount() > 0);
+
+        // and reading opens it again
+        qint64 received = 0;
+        for (int i = 0; i < 1000 && received < data.size(); i++) {
+            received += remote->readAll().size();
+            pump();
+            written += local->write(data.constData() + written, data.size() - written);
+            QTest::qWait(1);
+        }
+        QCOMPARE(received, qint64(data.size()));
+    }
+
+    void datagramTest()
+    {
+        client->associate();
+        pump();
+        auto local  = client->makeDatagramChannel("datagram", 3);
+        auto remote = server->makeDatagramChannel("datagram", 3);
+        int  ready  = 0;
+        connect(remote, &DatagramChannel::readyRead, this, [&ready]() { ready++; });
+
+        QVERIFY(local->sendMessage("text", DatagramChannel::String));
+        QVERIFY(local->sendMessage(QByteArray(), DatagramChannel::String));
+        QVERIFY(local->sendMessage(QByteArray()));
+        for (int i = 0; i < 20; i++) {
+            QVERIFY(local->sendMessage(QByteArray::number(i)));
+        }
+
+        // all the packets at once make one notification however many messages they bring
+        QList<QByteArray> packets;
+        for (auto data = client->readOutgoing(); !data.isEmpty(); data = client->readOutgoing()) {
+            packets.append(data);
+        }
+        QVERIFY(packets.size() > 1);
+        server->writeIncoming(packets);
+        QCOMPARE(ready, 1);
+
+        auto text = remote->readMessage();
+        QCOMPARE(text.data, QByteArray("text"));
+        QCOMPARE(text.type, DatagramChannel::String);
+        auto empty = remote->readMessage();
+        QVERIFY(!empty.data.isNull() && empty.data.isEmpty());
+        QCOMPARE(empty.type, DatagramChannel::StringEmpty);
+        QVERIFY(empty.isString());
+        QCOMPARE(remote->readMessage().type, DatagramChannel::BinaryEmpty);
+
+        auto messages = remote->readMessages(5);
+        QCOMPARE(messages.size(), 5);
+        for (const auto &message : remote->readMessages()) {
+            messages.append(message);
+        }
+        QCOMPARE(messages.size(), 20);
+        QVERIFY(!remote->hasPendingMessages());
+        QVERIFY(remote->readMessage().data.isNull());
+        // unordered, so only the set is known
+        QList<QByteArray> numbers;
+        for (const auto &message : messages) {
+            QCOMPARE(message.type, DatagramChannel::Binary);
+            numbers.append(message.data);
+        }
+        std::sort(numbers.begin(), numbers.end(), [](const QByteArray &a, const QByteArray &b) {
+            return a.toInt() < b.toInt();
+        });
+        for (int i = 0; i < 20; i++) {
+            QCOMPARE(numbers[i], QByteArray::number(i));
+        }
+    }
+};
+
+QTEST_MAIN(DataChannelTest)
+
+#include "datachannel.moc"
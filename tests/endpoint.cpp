@@ -0,0 +1,185 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_association.h"
+#include "sctp_endpoint.h"
+#include "sctp_flat_hash.h"
+
+#include <QTest>
+
+#include <algorithm>
+
+using namespace SctpDc::Sctp;
+
+class EndpointTest : public QObject {
+    Q_OBJECT
+
+    Endpoint *client = nullptr;
+    Endpoint *server = nullptr;
+
+    QList<Association *> serverAssociations;
+
+    void pump()
+    {
+        bool more = true;
+        while (more) {
+            more = false;
+            for (auto data = client->readOutgoing(); !data.isEmpty(); data = client->readOutgoing()) {
+                server->writeIncoming(data);
+                more = true;
+            }
+            for (auto data = server->readOutgoing(); !data.isEmpty(); data = server->readOutgoing()) {
+                client->writeIncoming(data);
+                more = true;
+            }
+        }
+    }
+
+private slots:
+    void init()
+    {
+        client = new Endpoint(this);
+        server = new Endpoint(this);
+        server->listen(5000);
+        serverAssociations.clear();
+        connect(server, &Endpoint::newAssociation, this,
+                [this](Association *association) { serverAssociations.append(association); });
+    }
+
+    void flatHashTest()
+    {
+        FlatHash<int> hash;
+        for (int i = 1; i <= 10000; i++) {
+            QVERIFY(hash.insert(quint64(i) << 32, i));
+        }
+        QVERIFY(!hash.insert(quint64(5) << 32, 0));
+        for (int i = 1; i <= 10000; i += 2) {
+            QVERIFY(hash.erase(quint64(i) << 32));
+        }
+        QCOMPARE(hash.size(), 5000);
+        for (int i = 1; i <= 10000; i++) {
+            auto value = hash.find(quint64(i) << 32);
+            QCOMPARE(bool(value), i % 2 == 0);
+            if (value) {
+                QCOMPARE(*value, i);
+            }
+        }
+        // zero marks empty slots
+        QVERIFY(!hash.find(0));
+        QVERIFY(!hash.erase(0));
+        QCOMPARE(hash.size(), 5000);
+    }
+
+    void zeroKeyTest()
+    {
+        client->associate(1000, 5000);
+        pump();
+        // ports 0/0 and vtag 0 make the key of an empty slot
+        QByteArray data(Packet::HeaderSize + 4, 0);
+        client->writeIncoming(data);
+        server->writeIncoming(data);
+    }
+
+    void routingTest()
+    {
+        // all share the same ports, so only the verification tag tells them apart
+        QList<Association *> clientAssociations;
+        for (int i = 0; i < 100; i++) {
+            clientAssociations.append(client->associate(1000, 5000));
+        }
+        pump();
+        QCOMPARE(serverAssociations.size(), 100);
+        QCOMPARE(server->associationsCount(), 100);
+        for (auto association : clientAssociations) {
+            QCOMPARE(association->state(), Association::State::Established);
+        }
+
+        for (int i = 0; i < clientAssociations.size(); i++) {
+            clientAssociations[i]->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray::number(i));
+        }
+        pump();
+        QList<int> received;
+        for (auto association : serverAssociations) {
+            QVERIFY(association->hasPendingMessages());
+            received.append(association->readIncoming().data.toInt());
+            QVERIFY(!association->hasPendingMessages());
+        }
+        std::sort(received.begin(), received.end());
+        for (int i = 0; i < received.size(); i++) {
+            QCOMPARE(received[i], i);
+        }
+    }
+
+    void removeTest()
+    {
+        auto first  = client->associate(1000, 5000);
+        auto second = client->associate(1000, 5000);
+        pump();
+        QCOMPARE(serverAssociations.size(), 2);
+
+        server->removeAssociation(serverAssociations[0]);
+        QCOMPARE(server->associationsCount(), 1);
+        first->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("data"));
+        second->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("data"));
+        pump();
+        QCOMPARE(serverAssociations[1]->readIncoming().data, QByteArray("data"));
+        QVERIFY(!serverAssociations[1]->hasPendingMessages());
+    }
+
+    void sharedTimerTest()
+    {
+        // timeouts of the associations are served by the endpoint's timer
+        auto association = client->associate(1000, 5000);
+        pump();
+        association->setNagleDelay(20000);
+        association->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("held"));
+        pump();
+        QVERIFY(!serverAssociations[0]->hasPendingMessages());
+        QTRY_VERIFY((pump(), serverAssociations[0]->hasPendingMessages()));
+        QCOMPARE(serverAssociations[0]->readIncoming().data, QByteArray("held"));
+    }
+
+    void deadPeerTest()
+    {
+        auto association = client->associate(1000, 5000);
+        pump();
+        QCOMPARE(client->associationsCount(), 1);
+
+        // the server is gone, so heartbeats are never answered
+        association->setRtoBounds(1000, 5000);
+        association->setMaxRetransmissions(2);
+        association->setHeartbeatInterval(5000);
+        QTRY_COMPARE((client->readOutgoing(), client->associationsCount()), 0);
+    }
+
+    void cleanup()
+    {
+        delete client;
+        delete server;
+    }
+};
+
+QTEST_MAIN(EndpointTest)
+
+#include "endpoint.moc"
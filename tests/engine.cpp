@@ -0,0 +1,134 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_association.h"
+#include "sctp_endpoint.h"
+#include "sctp_engine.h"
+#include "sctp_spsc_queue.h"
+
+#include <QTest>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+using namespace SctpDc::Sctp;
+
+class EngineTest : public QObject {
+    Q_OBJECT
+
+private slots:
+    void spscQueueTest()
+    {
+        constexpr int     count = 100000;
+        SpscQueue<int>    queue(64);
+        std::thread       producer([&queue]() {
+            for (int i = 0; i < count; i++) {
+                int value = i;
+                while (!queue.push(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        int  expected = 0;
+        bool ordered  = true;
+        while (expected < count) {
+            int value;
+            if (queue.pop(value)) {
+                ordered = ordered && value == expected;
+                expected++;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        QVERIFY(ordered);
+        QVERIFY(queue.isEmpty());
+    }
+
+    void shardTagTest()
+    {
+        const quint32 tags[] = { 0, 1, 2, 3, 0x7fffffff, 0xfffffffd, 0xfffffffe, 0xffffffff };
+        for (quint32 count : { 1u, 3u, 4u, 7u }) {
+            for (quint32 index = 0; index < count; index++) {
+                for (auto tag : tags) {
+                    auto sharded = shardVerificationTag(tag, index, count);
+                    QVERIFY(sharded);
+                    QCOMPARE(sharded % count, index);
+                }
+            }
+        }
+    }
+
+    void engineTest()
+    {
+        constexpr int    count = 50;
+        Engine           engine(4);
+        Endpoint         client;
+        std::atomic<int> accepted { 0 };
+        std::atomic<int> received { 0 };
+        for (int i = 0; i < engine.shardsCount(); i++) {
+            auto endpoint = engine.endpoint(i);
+            // runs in the shard's thread
+            connect(endpoint, &Endpoint::newAssociation, endpoint, [&accepted, &received](Association *association) {
+                accepted++;
+                connect(association, &Association::readyReadIncoming, association, [association, &received]() {
+                    while (association->hasPendingMessages()) {
+                        association->readIncoming();
+                        received++;
+                    }
+                });
+            });
+        }
+        engine.listen(5000);
+
+        auto pump = [&engine, &client]() {
+            for (auto data = client.readOutgoing(); !data.isEmpty(); data = client.readOutgoing()) {
+                engine.writeIncoming(data);
+            }
+            for (auto data = engine.readOutgoing(); !data.isEmpty(); data = engine.readOutgoing()) {
+                client.writeIncoming(data);
+            }
+        };
+
+        QList<Association *> associations;
+        for (int i = 0; i < count; i++) {
+            associations.append(client.associate(1000, 5000));
+        }
+        QTRY_VERIFY((pump(), accepted == count));
+        QTRY_VERIFY((pump(), std::all_of(associations.begin(), associations.end(), [](Association *association) {
+                         return association->state() == Association::State::Established;
+                     })));
+
+        for (auto association : associations) {
+            association->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("data"));
+        }
+        QTRY_VERIFY((pump(), received == count));
+        QCOMPARE(engine.droppedPackets(), quint64(0));
+    }
+};
+
+QTEST_MAIN(EngineTest)
+
+#include "engine.moc"
@@ -0,0 +1,143 @@
+/*
+Copyright (c) 2020, Sergey Ilinykh <rion4ik@gmail.com>
+
+Redistribution and use in source and binary forms, with or without
+modification, are permitted provided that the following conditions are met:
+
+1. Redistributions of source code must retain the above copyright notice, this
+   list of conditions and the following disclaimer.
+2. Redistributions in binary form must reproduce the above copyright notice,
+   this list of conditions and the following disclaimer in the documentation
+   and/or other materials provided with the distribution.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "sctp_association.h"
+#include "sctp_chunk.h"
+#include "sctp_listener.h"
+
+#include <QTest>
+
+#include <memory>
+
+using namespace SctpDc::Sctp;
+
+class ListenerTest : public QObject {
+    Q_OBJECT
+
+    Association *client   = nullptr;
+    Listener *   listener = nullptr;
+
+    // runs the handshake through the listener. returns the server side association if any
+    Association *handshake(bool tamper = false)
+    {
+        client->associate();
+        listener->writeIncoming(client->readOutgoing()); // init
+        client->writeIncoming(listener->readOutgoing()); // init-ack
+        QByteArray cookieEcho = client->readOutgoing();
+        if (tamper) {
+            cookieEcho[cookieEcho.size() - 1] = char(cookieEcho.at(cookieEcho.size() - 1) ^ 1);
+        }
+        listener->writeIncoming(cookieEcho);
+        auto server = listener->nextPendingAssociation();
+        if (server) {
+            client->writeIncoming(server->readOutgoing()); // cookie-ack
+        }
+        return server;
+    }
+
+private slots:
+    void init()
+    {
+        client   = new Association(1000, 5000, this);
+        listener = new Listener(5000, this);
+    }
+
+    void statelessInitTest()
+    {
+        const auto memoryUsage = Association::receiveWindowMemoryUsage();
+        client->associate();
+        listener->writeIncoming(client->readOutgoing());
+        QVERIFY(!listener->readOutgoing().isEmpty());
+        QVERIFY(!listener->hasPendingAssociations());
+        QCOMPARE(Association::receiveWindowMemoryUsage(), memoryUsage); // no association allocated
+    }
+
+    void establishTest()
+    {
+        bool signalled = false;
+        connect(listener, &Listener::newAssociation, this, [&signalled]() { signalled = true; });
+        std::unique_ptr<Association> server(handshake());
+        QVERIFY(server);
+        QVERIFY(signalled);
+        QCOMPARE(server->state(), Association::State::Established);
+        QCOMPARE(client->state(), Association::State::Established);
+
+        client->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("hello"));
+        server->writeIncoming(client->readOutgoing());
+        QCOMPARE(server->readIncoming().data, QByteArray("hello"));
+        server->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("world"));
+        client->writeIncoming(server->readOutgoing());
+        QCOMPARE(client->readIncoming().data, QByteArray("world"));
+    }
+
+    void bundledDataTest()
+    {
+        client->associate();
+        client->write(1, false, QByteArray("\0\0\0\x35", 4), QByteArray("early"));
+        listener->writeIncoming(client->readOutgoing());
+        client->writeIncoming(listener->readOutgoing());
+        listener->writeIncoming(client->readOutgoing()); // cookie-echo + data
+        std::unique_ptr<Association> server(listener->nextPendingAssociation());
+        QVERIFY(server);
+        QCOMPARE(server->readIncoming().data, QByteArray("early"));
+    }
+
+    void forgedCookieTest()
+    {
+        QVERIFY(!handshake(true));
+        QCOMPARE(client->state(), Association::State::CookieEchoed);
+    }
+
+    void secretRotationTest()
+    {
+        // a cookie signed with the previous secret is still good
+        client->associate();
+        listener->writeIncoming(client->readOutgoing());
+        client->writeIncoming(listener->readOutgoing());
+        listener->cookieSecret()->rotate();
+        listener->writeIncoming(client->readOutgoing());
+        QVERIFY(listener->hasPendingAssociations());
+    }
+
+    void expiredSecretTest()
+    {
+        client->associate();
+        listener->writeIncoming(client->readOutgoing());
+        client->writeIncoming(listener->readOutgoing());
+        listener->cookieSecret()->rotate();
+        listener->cookieSecret()->rotate();
+        listener->writeIncoming(client->readOutgoing());
+        QVERIFY(!listener->hasPendingAssociations());
+    }
+
+    void cleanup()
+    {
+        delete client;
+        delete listener;
+    }
+};
+
+QTEST_MAIN(ListenerTest)
+
+#include "listener.moc"